@@ -0,0 +1,424 @@
+/**
+ * \file main.cpp
+ * \brief Headless end-to-end benchmark of the roster refresh path
+ *
+ * \details Plays the server on localhost and serves a synthetic roster to a
+ * real MainWindow running on the offscreen platform plugin. The frame goes
+ * through ClientConnection::slotReadyRead, the negotiated decoder and
+ * CharacterTableModel exactly as it does in the client.
+ *
+ * Usage: table_refresh_bench [--rows N] [--layout rows|compact|columnar]
+ *
+ * Without --rows the 10k, 100k and 1M sizes are run one process each, so
+ * peak RSS is reported per size. Reported columns:
+ * - wire_mb: size of the roster frame
+ * - decode_ms: the decoder alone, run on the same payload afterwards
+ * - first_ms: frame written to the first rows in the model
+ * - e2e_ms: frame written to the last rows in the model
+ * - model_ms: time spent inside the model reset and row inserts
+ * - paint_ms: last rows in the model to the viewport paint finished
+ * - buf_kb: high-water mark of the client receive buffer
+ * - rss_mb: peak resident set size of the process
+ *
+ * The fake server lives in the same process, so rss_mb includes the
+ * synthetic roster and its encoded frame.
+ */
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QProcess>
+#include <QTableView>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTextStream>
+#include <QTimer>
+
+#include <sys/resource.h>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <random>
+
+#include "main_window.h"
+
+namespace {
+
+enum class Layout { Rows, Compact, Columnar };
+
+// Long enough for 1M rows on a slow machine, short enough not to hang CI
+constexpr int RUN_TIMEOUT_MS = 15 * 60 * 1000;
+
+const char* layoutName(Layout layout) {
+    switch (layout) {
+    case Layout::Compact:
+        return "compact";
+    case Layout::Columnar:
+        return "columnar";
+    default:
+        return "rows";
+    }
+}
+
+bool parseLayout(const QString& name, Layout& layout) {
+    if (name == "rows") {
+        layout = Layout::Rows;
+    } else if (name == "compact") {
+        layout = Layout::Compact;
+    } else if (name == "columnar") {
+        layout = Layout::Columnar;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+uint32_t layoutFeatures(Layout layout) {
+    uint32_t features = Protocol::FEATURE_LENGTH_FRAMED | Protocol::FEATURE_PROJECTION;
+    if (layout == Layout::Compact) {
+        features |= Protocol::FEATURE_VARINT_ENCODING;
+    } else if (layout == Layout::Columnar) {
+        features |= Protocol::FEATURE_COLUMNAR;
+    }
+    return features;
+}
+
+std::string randomWord(std::mt19937& rng, size_t minLength, size_t maxLength) {
+    static const char letters[] = "abcdefghijklmnopqrstuvwxyz";
+    std::uniform_int_distribution<size_t> length(minLength, maxLength);
+    std::uniform_int_distribution<size_t> letter(0, sizeof(letters) - 2);
+    std::string word(length(rng), 'a');
+    for (char& c : word) {
+        c = letters[letter(rng)];
+    }
+    word[0] = static_cast<char>(word[0] - 'a' + 'A');
+    return word;
+}
+
+// Realistic cardinalities: few names, more surnames, unique bios
+std::vector<CharacterData> generateCharacters(size_t rows) {
+    std::mt19937 rng(42);
+    std::vector<std::string> names;
+    std::vector<std::string> surnames;
+    for (int i = 0; i < 200; ++i) {
+        names.push_back(randomWord(rng, 3, 10));
+    }
+    for (int i = 0; i < 2000; ++i) {
+        surnames.push_back(randomWord(rng, 4, 14));
+    }
+
+    std::uniform_int_distribution<size_t> name(0, names.size() - 1);
+    std::uniform_int_distribution<size_t> surname(0, surnames.size() - 1);
+    std::uniform_int_distribution<int> age(1, 179);
+    std::uniform_int_distribution<int> words(3, 60);
+
+    std::vector<CharacterData> characters(rows);
+    for (size_t i = 0; i < rows; ++i) {
+        CharacterData& character = characters[i];
+        character.id = static_cast<int32_t>(i + 1);
+        character.name = names[name(rng)];
+        character.surname = surnames[surname(rng)];
+        character.age = static_cast<uint8_t>(age(rng));
+        for (int w = words(rng); w > 0; --w) {
+            character.bio += randomWord(rng, 2, 9);
+            character.bio += ' ';
+        }
+    }
+    return characters;
+}
+
+CharacterData project(const CharacterData& character, uint16_t bioPreviewLength) {
+    CharacterData projected = character;
+    if (bioPreviewLength != 0 && projected.bio.size() > bioPreviewLength) {
+        projected.bio.resize(bioPreviewLength);
+    }
+    return projected;
+}
+
+std::vector<uint8_t> encodeRoster(const std::vector<CharacterData>& characters, Layout layout,
+                                  uint16_t bioPreviewLength) {
+    if (layout == Layout::Columnar) {
+        CharacterColumns columns;
+        columns.reserve(characters.size());
+        for (const auto& character : characters) {
+            columns.append(project(character, bioPreviewLength));
+        }
+        return columns.serialize();
+    }
+
+    std::vector<CharacterData> projected;
+    projected.reserve(characters.size());
+    for (const auto& character : characters) {
+        projected.push_back(project(character, bioPreviewLength));
+    }
+    if (layout == Layout::Compact) {
+        return CharacterData::serializeVectorCompact(projected);
+    }
+    return CharacterData::serializeVector(projected);
+}
+
+double decodeMs(const std::vector<uint8_t>& payload, Layout layout) {
+    QElapsedTimer timer;
+    timer.start();
+    size_t rows = 0;
+    if (layout == Layout::Columnar) {
+        rows = CharacterColumns::deserialize(payload).size();
+    } else if (layout == Layout::Compact) {
+        rows = CharacterData::deserializeVectorCompact(payload).size();
+    } else {
+        rows = CharacterData::deserializeVector(payload).size();
+    }
+    Q_UNUSED(rows)
+    return timer.nsecsElapsed() / 1e6;
+}
+
+void writeMessage(QTcpSocket* socket, bool framed, uint8_t command, const std::vector<uint8_t>& payload) {
+    std::vector<uint8_t> message;
+    message.reserve(sizeof(uint32_t) + 1 + payload.size() + Protocol::MESSAGE_DELIMITER_SIZE);
+    if (framed) {
+        uint32_t length = static_cast<uint32_t>(1 + payload.size());
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&length);
+        message.insert(message.end(), bytes, bytes + sizeof(length));
+    }
+    message.push_back(command);
+    message.insert(message.end(), payload.begin(), payload.end());
+    if (!framed) {
+        message.insert(message.end(), Protocol::MESSAGE_DELIMITER.begin(), Protocol::MESSAGE_DELIMITER.end());
+    }
+    socket->write(reinterpret_cast<const char*>(message.data()), message.size());
+}
+
+/**
+ * \brief Minimal server side of the protocol, enough for one refresh
+ */
+struct FakeServer {
+    QTcpServer server;
+    QTcpSocket* socket = nullptr;
+    std::vector<uint8_t> buffer;
+    bool framed = false;
+    uint32_t features = 0;
+    Layout layout = Layout::Rows;
+    const std::vector<CharacterData>* characters = nullptr;
+    std::vector<uint8_t> roster;
+    std::function<void()> onRosterSent;
+
+    bool nextMessage(std::vector<uint8_t>& message) {
+        if (framed) {
+            uint32_t length = 0;
+            if (buffer.size() < sizeof(length)) {
+                return false;
+            }
+            std::memcpy(&length, buffer.data(), sizeof(length));
+            if (buffer.size() - sizeof(length) < length) {
+                return false;
+            }
+            message.assign(buffer.begin() + sizeof(length), buffer.begin() + sizeof(length) + length);
+            buffer.erase(buffer.begin(), buffer.begin() + sizeof(length) + length);
+            return true;
+        }
+        auto it = std::search(buffer.begin(), buffer.end(),
+                              Protocol::MESSAGE_DELIMITER.begin(), Protocol::MESSAGE_DELIMITER.end());
+        if (it == buffer.end()) {
+            return false;
+        }
+        message.assign(buffer.begin(), it);
+        buffer.erase(buffer.begin(), it + Protocol::MESSAGE_DELIMITER_SIZE);
+        return true;
+    }
+
+    void handle(const std::vector<uint8_t>& message) {
+        if (message.empty()) {
+            return;
+        }
+        const uint8_t command = message[0];
+        switch (command) {
+        case Protocol::HELLO: {
+            uint32_t offered = 0;
+            if (message.size() >= 1 + sizeof(offered)) {
+                std::memcpy(&offered, message.data() + 1, sizeof(offered));
+            }
+            uint32_t accepted = offered & features;
+            std::vector<uint8_t> payload(sizeof(accepted));
+            std::memcpy(payload.data(), &accepted, sizeof(accepted));
+            writeMessage(socket, framed, Protocol::HELLO, payload);
+            framed = accepted & Protocol::FEATURE_LENGTH_FRAMED;
+            break;
+        }
+        case Protocol::SUBSCRIBE:
+            writeMessage(socket, framed, Protocol::SUBSCRIBE, {});
+            break;
+        case Protocol::GET_ALL:
+        case Protocol::GET_ALL_COLUMNAR: {
+            uint16_t bioPreviewLength = 0;
+            if (message.size() >= 2 + sizeof(bioPreviewLength)) {
+                std::memcpy(&bioPreviewLength, message.data() + 2, sizeof(bioPreviewLength));
+            }
+            roster = encodeRoster(*characters, layout, bioPreviewLength);
+            writeMessage(socket, framed, command, roster);
+            onRosterSent();
+            break;
+        }
+        default:
+            writeMessage(socket, framed, Protocol::RESP_ERROR, {});
+        }
+    }
+};
+
+long peakRssKb() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    // Kilobytes on Linux
+    return usage.ru_maxrss;
+}
+
+int runOnce(QApplication& app, size_t rows, Layout layout, bool header) {
+    QTextStream out(stdout);
+    std::vector<CharacterData> characters = generateCharacters(rows);
+
+    FakeServer fake;
+    fake.features = layoutFeatures(layout);
+    fake.layout = layout;
+    fake.characters = &characters;
+    // Any free port, a real server or another run may hold Protocol::PORT
+    if (!fake.server.listen(QHostAddress::LocalHost, 0)) {
+        out << "Cannot listen: " << fake.server.errorString() << Qt::endl;
+        return 1;
+    }
+
+    QElapsedTimer clock;
+    clock.start();
+    qint64 sentAt = 0;
+    qint64 firstRowsAt = 0;
+    qint64 lastRowsAt = 0;
+    qint64 modelNs = 0;
+    qint64 modelBeginAt = 0;
+    qint64 paintedAt = 0;
+
+    fake.onRosterSent = [&]() { sentAt = clock.nsecsElapsed(); };
+    QObject::connect(&fake.server, &QTcpServer::newConnection, [&]() {
+        fake.socket = fake.server.nextPendingConnection();
+        QObject::connect(fake.socket, &QTcpSocket::readyRead, [&]() {
+            QByteArray data = fake.socket->readAll();
+            fake.buffer.insert(fake.buffer.end(), data.begin(), data.end());
+            std::vector<uint8_t> message;
+            while (fake.nextMessage(message)) {
+                fake.handle(message);
+            }
+        });
+    });
+
+    MainWindow window(QString("127.0.0.1:%1").arg(fake.server.serverPort()));
+    window.show();
+
+    auto* model = window.findChild<CharacterTableModel*>();
+    auto* view = window.findChild<QTableView*>("tableView");
+    auto* connection = window.findChild<ClientConnection*>();
+    // The roster arrives as one reset followed by row inserts
+    auto modelBegin = [&]() { modelBeginAt = clock.nsecsElapsed(); };
+    auto modelEnd = [&]() {
+        qint64 now = clock.nsecsElapsed();
+        modelNs += now - modelBeginAt;
+        if (firstRowsAt == 0) {
+            firstRowsAt = now;
+        }
+    };
+    QObject::connect(model, &QAbstractItemModel::modelAboutToBeReset, modelBegin);
+    QObject::connect(model, &QAbstractItemModel::rowsAboutToBeInserted, modelBegin);
+    QObject::connect(model, &QAbstractItemModel::modelReset, modelEnd);
+    QObject::connect(model, &QAbstractItemModel::rowsInserted, modelEnd);
+    // Connected after MainWindow, so the model holds every row by now
+    QObject::connect(connection, &ClientConnection::signalStreamFinished, [&](int, bool success) {
+        if (!success) {
+            app.exit(3);
+            return;
+        }
+        lastRowsAt = clock.nsecsElapsed();
+        // Let the view finish handling the inserts, then paint as the event loop would
+        QTimer::singleShot(0, [&]() {
+            view->viewport()->repaint();
+            paintedAt = clock.nsecsElapsed();
+            app.quit();
+        });
+    });
+
+    QTimer::singleShot(RUN_TIMEOUT_MS, [&]() { app.exit(2); });
+    if (int code = app.exec(); code != 0) {
+        out << (code == 2 ? "Timed out waiting for the roster" : "Roster stream failed") << Qt::endl;
+        return 1;
+    }
+
+    const long rssKb = peakRssKb();
+    const double decode = decodeMs(fake.roster, layout);
+
+    if (header) {
+        out << "rows\tlayout\twire_mb\tdecode_ms\tfirst_ms\te2e_ms\tmodel_ms\tpaint_ms\tbuf_kb\trss_mb" << Qt::endl;
+    }
+    out << rows << '\t' << layoutName(layout) << '\t'
+        << QString::number(fake.roster.size() / 1048576.0, 'f', 1) << '\t'
+        << QString::number(decode, 'f', 1) << '\t'
+        << QString::number((firstRowsAt - sentAt) / 1e6, 'f', 1) << '\t'
+        << QString::number((lastRowsAt - sentAt) / 1e6, 'f', 1) << '\t'
+        << QString::number(modelNs / 1e6, 'f', 1) << '\t'
+        << QString::number((paintedAt - lastRowsAt) / 1e6, 'f', 1) << '\t'
+        << connection->bufferStats().bufferHighWater / 1024 << '\t'
+        << QString::number(rssKb / 1024.0, 'f', 1) << Qt::endl;
+    return 0;
+}
+
+int runSweep(const QList<Layout>& layouts) {
+    QTextStream out(stdout);
+    out << "rows\tlayout\twire_mb\tdecode_ms\tfirst_ms\te2e_ms\tmodel_ms\tpaint_ms\tbuf_kb\trss_mb" << Qt::endl;
+
+    for (size_t rows : {10'000, 100'000, 1'000'000}) {
+        for (Layout layout : layouts) {
+            // Fresh process per run, peak RSS never goes down
+            QProcess child;
+            child.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+            child.start(QCoreApplication::applicationFilePath(),
+                        {"--rows", QString::number(rows), "--layout", layoutName(layout), "--no-header"});
+            if (!child.waitForFinished(RUN_TIMEOUT_MS) || child.exitCode() != 0) {
+                out << rows << '\t' << layoutName(layout) << "\tfailed" << Qt::endl;
+                continue;
+            }
+            out << child.readAllStandardOutput();
+            out.flush();
+        }
+    }
+    return 0;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+
+    size_t rows = 0;
+    bool header = true;
+    QList<Layout> layouts = {Layout::Rows, Layout::Compact, Layout::Columnar};
+    const QStringList args = QCoreApplication::arguments();
+    for (int i = 1; i < args.size(); ++i) {
+        if (args[i] == "--rows" && i + 1 < args.size()) {
+            rows = args[++i].toULong();
+        } else if (args[i] == "--layout" && i + 1 < args.size()) {
+            Layout layout;
+            if (!parseLayout(args[++i], layout)) {
+                QTextStream(stderr) << "Unknown layout " << args[i] << Qt::endl;
+                return 1;
+            }
+            layouts = {layout};
+        } else if (args[i] == "--no-header") {
+            header = false;
+        } else {
+            QTextStream(stderr) << "Usage: table_refresh_bench [--rows N] [--layout rows|compact|columnar]" << Qt::endl;
+            return 1;
+        }
+    }
+
+    if (rows == 0) {
+        return runSweep(layouts);
+    }
+    return runOnce(app, rows, layouts.first(), header);
+}
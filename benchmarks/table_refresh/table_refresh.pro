@@ -0,0 +1,14 @@
+# Headless end-to-end benchmark of the roster refresh path.
+# Run without arguments for the 10k/100k/1M sweep, see main.cpp.
+
+QT       += core gui network widgets
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = table_refresh_bench
+
+include(../../character_client/character_client.pri)
+
+SOURCES += \
+    main.cpp
@@ -1,5 +1,6 @@
 #include "add_character_dialog.h"
 #include "ui_add_character_dialog.h"
+#include "character_validation.h"
 #include <QMessageBox>
 #include <QRegularExpression>
 #include <QRegularExpressionValidator>
@@ -15,11 +16,11 @@ AddCharacterDialog::AddCharacterDialog(QWidget* parent) :
     ui->nameErrorLabel->hide();
     ui->surnameErrorLabel->hide();
 
-    ui->nameEdit->setMaxLength(50);
-    ui->surnameEdit->setMaxLength(50);
+    ui->nameEdit->setMaxLength(CharacterValidation::MAX_NAME_LENGTH);
+    ui->surnameEdit->setMaxLength(CharacterValidation::MAX_NAME_LENGTH);
 
     // Set up validators for name and surname
-    QRegularExpression nameRegex("^[a-zA-Z ]+$");
+    QRegularExpression nameRegex(CharacterValidation::namePattern());
     ui->nameEdit->setValidator(new QRegularExpressionValidator(nameRegex, this));
     ui->surnameEdit->setValidator(new QRegularExpressionValidator(nameRegex, this));
 
@@ -27,8 +28,8 @@ AddCharacterDialog::AddCharacterDialog(QWidget* parent) :
     ui->bioEdit->setPlainText("no bio yet");
 
     // Set age range
-    ui->ageSpin->setMinimum(1);
-    ui->ageSpin->setMaximum(179);
+    ui->ageSpin->setMinimum(CharacterValidation::MIN_AGE);
+    ui->ageSpin->setMaximum(CharacterValidation::MAX_AGE);
 
     // Map widgets to their error labels
     m_errorLabels.insert(ui->nameEdit, ui->nameErrorLabel);
@@ -57,7 +58,7 @@ void AddCharacterDialog::accept() {
 }
 
 bool AddCharacterDialog::validateName(const QString& name) {
-    return !name.isEmpty() && name.contains(QRegularExpression("^[a-zA-Z ]+$"));
+    return CharacterValidation::isValidName(name);
 }
 
 bool AddCharacterDialog::validateForm() {
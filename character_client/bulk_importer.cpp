@@ -0,0 +1,314 @@
+#include "bulk_importer.h"
+#include "character_validation.h"
+
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <cstring>
+
+namespace {
+constexpr qint64 PROGRESS_INTERVAL_MS = 250;
+}
+
+BulkImporter::BulkImporter(ClientConnection* connection, QObject* parent)
+    : QObject(parent), m_connection(connection)
+{
+    connect(
+                m_connection, &ClientConnection::signalBatchCompleted,
+                this, &BulkImporter::slotBatchCompleted
+                );
+    connect(
+                m_connection, &ClientConnection::signalConnectionFailed,
+                this, &BulkImporter::slotConnectionFailed
+                );
+}
+
+BulkImporter::~BulkImporter() {
+    if (m_data) {
+        m_file.unmap(reinterpret_cast<uchar*>(const_cast<char*>(m_data)));
+    }
+}
+
+bool BulkImporter::start(const QString& path, QString& error) {
+    if (m_running) {
+        error = "Import already running";
+        return false;
+    }
+    // Their acknowledgements would be counted as this import's
+    if (m_inFlight != 0) {
+        error = "Previous import still finishing";
+        return false;
+    }
+    // Imports are mutations, only the primary takes them
+    if (!m_connection->canWrite()) {
+        error = "Primary server unavailable";
+        return false;
+    }
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        error = m_file.errorString();
+        return false;
+    }
+    m_size = m_file.size();
+    m_offset = 0;
+    m_data = nullptr;
+    if (m_size > 0) {
+        m_data = reinterpret_cast<const char*>(m_file.map(0, m_size));
+        if (!m_data) {
+            error = m_file.errorString();
+            m_file.close();
+            return false;
+        }
+    }
+
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    if (suffix == "ndjson" || suffix == "jsonl") {
+        m_format = Format::Ndjson;
+    } else if (suffix == "csv") {
+        m_format = Format::Csv;
+    } else {
+        // Sniff the first non-blank character, .json may hold either kind of JSON
+        qint64 i = 0;
+        while (i < m_size && (m_data[i] == ' ' || m_data[i] == '\t' || m_data[i] == '\r' || m_data[i] == '\n')) {
+            ++i;
+        }
+        if (i < m_size && m_data[i] == '[') {
+            error = "JSON arrays are not supported, use NDJSON with one object per line";
+            m_file.unmap(reinterpret_cast<uchar*>(const_cast<char*>(m_data)));
+            m_data = nullptr;
+            m_file.close();
+            return false;
+        }
+        m_format = (i < m_size && m_data[i] == '{') ? Format::Ndjson : Format::Csv;
+    }
+
+    m_imported = 0;
+    m_rejected = 0;
+    m_running = true;
+    m_clock.start();
+    m_lastProgressMs = 0;
+
+    if (m_format == Format::Csv) {
+        // A header of the previous file must not reorder this one
+        for (int column = 0; column < CsvColumnCount; ++column) {
+            m_csvColumns[column] = column;
+        }
+        readCsvHeader();
+    }
+    pump();
+    return true;
+}
+
+void BulkImporter::cancel() {
+    if (m_running) {
+        finish("Import cancelled");
+    }
+}
+
+void BulkImporter::pump() {
+    if (!m_running) {
+        return;
+    }
+    if (!m_connection->canWrite()) {
+        finish("Primary server unavailable");
+        return;
+    }
+
+    const quint64 limit = static_cast<quint64>(m_batchSize) * m_maxInFlight;
+    while (m_inFlight + m_batchSize <= limit && m_offset < m_size) {
+        std::vector<CharacterData> batch;
+        batch.reserve(m_batchSize);
+
+        CharacterData character;
+        bool valid = false;
+        while (batch.size() < static_cast<size_t>(m_batchSize) && nextRecord(character, valid)) {
+            if (valid) {
+                batch.push_back(character);
+            } else {
+                ++m_rejected;
+            }
+        }
+        if (batch.empty()) {
+            break;
+        }
+
+        m_inFlight += batch.size();
+        m_connection->addCharacters(batch);
+    }
+
+    reportProgress(false);
+    if (m_offset >= m_size && m_inFlight == 0) {
+        finish(QString());
+    }
+}
+
+void BulkImporter::slotBatchCompleted(quint32 added, quint32 rejected) {
+    m_inFlight -= qMin<quint64>(m_inFlight, static_cast<quint64>(added) + rejected);
+    // Left over from a finished import, only drained
+    if (!m_running) {
+        return;
+    }
+    m_imported += added;
+    m_rejected += rejected;
+    pump();
+}
+
+void BulkImporter::slotConnectionFailed(const QString& error) {
+    if (m_running) {
+        finish("Connection failed: " + error);
+    }
+}
+
+bool BulkImporter::nextRecord(CharacterData& character, bool& valid) {
+    if (m_format == Format::Csv) {
+        QList<QByteArray> fields;
+        if (!nextCsvFields(fields)) {
+            return false;
+        }
+        auto field = [&](CsvColumn column) {
+            int index = m_csvColumns[column];
+            return index < fields.size() ? QString::fromUtf8(fields[index]) : QString();
+        };
+        bool ageOk = false;
+        int age = field(CsvAge).trimmed().toInt(&ageOk);
+        valid = ageOk && fillCharacter(character, field(CsvName), field(CsvSurname), age, field(CsvBio));
+        return true;
+    }
+
+    // NDJSON, skipping blank lines
+    while (m_offset < m_size) {
+        const char* begin = m_data + m_offset;
+        const char* end = static_cast<const char*>(memchr(begin, '\n', m_size - m_offset));
+        qint64 length = end ? end - begin : m_size - m_offset;
+        m_offset += length + (end ? 1 : 0);
+
+        // No copy, the document parses straight from the mapping
+        QByteArray line = QByteArray::fromRawData(begin, length).trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+        QJsonParseError parseError;
+        QJsonDocument document = QJsonDocument::fromJson(line, &parseError);
+        if (parseError.error != QJsonParseError::NoError || !document.isObject()) {
+            valid = false;
+            return true;
+        }
+        QJsonObject object = document.object();
+        valid = fillCharacter(character, object.value("name").toString(), object.value("surname").toString(),
+                              object.value("age").toInt(-1), object.value("bio").toString());
+        return true;
+    }
+    return false;
+}
+
+bool BulkImporter::nextCsvFields(QList<QByteArray>& fields) {
+    fields.clear();
+    // Skip blank lines between records
+    while (m_offset < m_size && (m_data[m_offset] == '\r' || m_data[m_offset] == '\n')) {
+        ++m_offset;
+    }
+    if (m_offset >= m_size) {
+        return false;
+    }
+
+    QByteArray field;
+    bool quoted = false;
+    while (m_offset < m_size) {
+        char c = m_data[m_offset++];
+        if (quoted) {
+            if (c == '"') {
+                // "" inside quotes is a literal quote
+                if (m_offset < m_size && m_data[m_offset] == '"') {
+                    field.append('"');
+                    ++m_offset;
+                } else {
+                    quoted = false;
+                }
+            } else {
+                field.append(c);
+            }
+            continue;
+        }
+
+        if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields.append(field);
+            field.clear();
+        } else if (c == '\n') {
+            break;
+        } else if (c != '\r') {
+            field.append(c);
+        }
+    }
+    fields.append(field);
+    return true;
+}
+
+void BulkImporter::readCsvHeader() {
+    const qint64 start = m_offset;
+    QList<QByteArray> fields;
+    if (!nextCsvFields(fields)) {
+        return;
+    }
+
+    static const char* names[CsvColumnCount] = {"name", "surname", "age", "bio"};
+    int mapping[CsvColumnCount] = {-1, -1, -1, -1};
+    for (int i = 0; i < fields.size(); ++i) {
+        const QByteArray header = fields[i].trimmed().toLower();
+        for (int column = 0; column < CsvColumnCount; ++column) {
+            if (header == names[column]) {
+                mapping[column] = i;
+            }
+        }
+    }
+
+    if (mapping[CsvName] < 0) {
+        // No header, the first line is data
+        m_offset = start;
+        return;
+    }
+    for (int column = 0; column < CsvColumnCount; ++column) {
+        // A missing column reads as an empty field
+        m_csvColumns[column] = mapping[column] < 0 ? CsvColumnCount + fields.size() : mapping[column];
+    }
+}
+
+bool BulkImporter::fillCharacter(CharacterData& character, const QString& name, const QString& surname,
+                                 int age, const QString& bio) const {
+    if (!CharacterValidation::isValidName(name) || !CharacterValidation::isValidName(surname)
+            || !CharacterValidation::isValidAge(age)) {
+        return false;
+    }
+    character.id = 0;
+    character.name = name.toStdString();
+    character.surname = surname.toStdString();
+    character.age = static_cast<uint8_t>(age);
+    character.bio = bio.toStdString();
+    return true;
+}
+
+void BulkImporter::reportProgress(bool force) {
+    const qint64 now = m_clock.elapsed();
+    if (!force && now - m_lastProgressMs < PROGRESS_INTERVAL_MS) {
+        return;
+    }
+    m_lastProgressMs = now;
+    const double rate = now > 0 ? m_imported * 1000.0 / now : 0.0;
+    emit signalProgress(m_offset, m_size, m_imported, m_rejected, rate);
+}
+
+void BulkImporter::finish(const QString& error) {
+    m_running = false;
+    // Records still on the wire are not counted, but start() waits for
+    // their acknowledgements, failed or not, before the next import
+    if (m_data) {
+        m_file.unmap(reinterpret_cast<uchar*>(const_cast<char*>(m_data)));
+        m_data = nullptr;
+    }
+    m_file.close();
+
+    reportProgress(true);
+    emit signalFinished(m_imported, m_rejected, error);
+}
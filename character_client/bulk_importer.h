@@ -0,0 +1,189 @@
+/**
+ * \file bulk_importer.h
+ * \brief Streaming import of characters from CSV or NDJSON files
+ */
+
+#ifndef BULK_IMPORTER_H
+#define BULK_IMPORTER_H
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QObject>
+#include "client_connection.h"
+
+/**
+ * \class BulkImporter
+ * \brief Feeds a character file to the server in batches
+ *
+ * \details The file is memory-mapped and parsed only as far as needed to
+ * fill the next batch, so parsing stops while the server is behind. At
+ * most maxInFlight() batches are unacknowledged at any time. Records that
+ * break the rules of AddCharacterDialog are counted as rejected and never
+ * sent.
+ *
+ * Supported formats, picked by file suffix, or by the first character if
+ * the suffix is unknown:
+ * - CSV: name,surname,age,bio. A header row naming these columns may
+ *   reorder them. Fields may be quoted, with "" as an escaped quote.
+ * - NDJSON: one {"name", "surname", "age", "bio"} object per line.
+ *   A .json file is sniffed, a single JSON array is refused.
+ */
+class BulkImporter : public QObject {
+    Q_OBJECT
+
+public:
+    /**
+     * \brief Supported source formats
+     */
+    enum class Format {
+        Csv,
+        Ndjson
+    };
+
+    /**
+     * \brief Constructs an idle importer
+     * \param connection Connection records are sent through
+     * \param parent Optional QObject parent
+     */
+    explicit BulkImporter(ClientConnection* connection, QObject* parent = nullptr);
+
+    /**
+     * \brief Destructor - releases the file mapping
+     */
+    ~BulkImporter();
+
+    /**
+     * \brief Sets the number of records per request
+     * \param batchSize Records per batch
+     */
+    void setBatchSize(int batchSize) { m_batchSize = qMax(1, batchSize); }
+
+    /**
+     * \brief Sets the number of unacknowledged batches allowed
+     * \param maxInFlight Batch count
+     */
+    void setMaxInFlight(int maxInFlight) { m_maxInFlight = qMax(1, maxInFlight); }
+
+    /**
+     * \brief Returns the number of unacknowledged batches allowed
+     * \return int Batch count
+     */
+    int maxInFlight() const { return m_maxInFlight; }
+
+    /**
+     * \brief Starts importing a file
+     * \param path File to import
+     * \param error [out] Reason the import could not start
+     * \return bool True if the import started
+     *
+     * \note Emits signalFinished() once every sent record is acknowledged
+     * \note Refused until the batches of a cancelled or failed import
+     * are acknowledged
+     */
+    bool start(const QString& path, QString& error);
+
+    /**
+     * \brief Stops sending, records already sent are not recalled
+     */
+    void cancel();
+
+signals:
+    /**
+     * \brief Emitted periodically while importing
+     * \param bytesParsed Source bytes parsed so far
+     * \param bytesTotal Source file size
+     * \param imported Records stored by the server
+     * \param rejected Records refused locally or by the server
+     * \param recordsPerSecond Stored records per second since start
+     */
+    void signalProgress(qint64 bytesParsed, qint64 bytesTotal, quint64 imported, quint64 rejected,
+                        double recordsPerSecond);
+
+    /**
+     * \brief Emitted when the import ends
+     * \param imported Records stored by the server
+     * \param rejected Records refused locally or by the server
+     * \param error Empty on success, reason otherwise
+     */
+    void signalFinished(quint64 imported, quint64 rejected, const QString& error);
+
+private slots:
+    /**
+     * \brief Accounts an acknowledged batch and sends more
+     * \param added Records stored by the server
+     * \param rejected Records refused by the server
+     */
+    void slotBatchCompleted(quint32 added, quint32 rejected);
+
+    /**
+     * \brief Aborts the import on connection loss
+     * \param error Error description
+     */
+    void slotConnectionFailed(const QString& error);
+
+private:
+    /**
+     * \brief Parses and sends batches while the in-flight budget allows
+     */
+    void pump();
+
+    /**
+     * \brief Parses the next record
+     * \param character [out] Parsed record
+     * \param valid [out] True if the record passed validation
+     * \return bool False at end of file
+     */
+    bool nextRecord(CharacterData& character, bool& valid);
+
+    /**
+     * \brief Splits the next CSV record into fields
+     * \param fields [out] Unquoted fields
+     * \return bool False at end of file
+     */
+    bool nextCsvFields(QList<QByteArray>& fields);
+
+    /**
+     * \brief Reads an optional CSV header and sets the column order
+     */
+    void readCsvHeader();
+
+    /**
+     * \brief Applies the AddCharacterDialog rules and fills a record
+     * \return bool True if the record is valid
+     */
+    bool fillCharacter(CharacterData& character, const QString& name, const QString& surname,
+                       int age, const QString& bio) const;
+
+    /**
+     * \brief Emits progress, at most every few hundred milliseconds unless forced
+     * \param force Emit regardless of the last emission
+     */
+    void reportProgress(bool force);
+
+    /**
+     * \brief Releases the file and emits signalFinished()
+     * \param error Empty on success, reason otherwise
+     */
+    void finish(const QString& error);
+
+    /// CSV columns, in default order
+    enum CsvColumn { CsvName, CsvSurname, CsvAge, CsvBio, CsvColumnCount };
+
+    ClientConnection* m_connection;          ///< Connection records are sent through
+    QFile m_file;                            ///< Source file
+    const char* m_data = nullptr;            ///< Mapped file contents
+    qint64 m_size = 0;                       ///< Mapped size
+    qint64 m_offset = 0;                     ///< Parse position
+    Format m_format = Format::Csv;           ///< Source format
+    int m_csvColumns[CsvColumnCount] = {0, 1, 2, 3}; ///< Field index of each CSV column
+    int m_batchSize = 500;                   ///< Records per batch
+    int m_maxInFlight = 4;                   ///< Unacknowledged batches allowed
+    quint64 m_inFlight = 0;                  ///< Records sent and not acknowledged, kept past finish()
+    quint64 m_imported = 0;                  ///< Records stored by the server
+    quint64 m_rejected = 0;                  ///< Records refused locally or by the server
+    bool m_running = false;                  ///< Import in progress
+    QElapsedTimer m_clock;                   ///< Time since start
+    qint64 m_lastProgressMs = 0;             ///< Time of the last progress signal
+};
+
+#endif // BULK_IMPORTER_H
@@ -0,0 +1,47 @@
+# Client sources shared by the application and the benchmarks.
+# Everything except main.cpp, paths are relative to this file.
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/add_character_dialog.cpp \
+    $$PWD/bulk_importer.cpp \
+    $$PWD/character_info_dialog.cpp \
+    $$PWD/character_table_model.cpp \
+    $$PWD/character_validation.cpp \
+    $$PWD/client_connection.cpp \
+    $$PWD/detail_prefetcher.cpp \
+    $$PWD/frame_buffer.cpp \
+    $$PWD/main_window.cpp \
+    $$PWD/protocol.cpp \
+    $$PWD/roster_exporter.cpp \
+    $$PWD/roster_stream_decoder.cpp \
+    $$PWD/server_link.cpp \
+    $$PWD/shared_memory_transport.cpp \
+    $$PWD/shared_ring.cpp \
+    $$PWD/timer_wheel.cpp \
+    $$PWD/transport.cpp
+
+HEADERS += \
+    $$PWD/add_character_dialog.h \
+    $$PWD/bulk_importer.h \
+    $$PWD/character_info_dialog.h \
+    $$PWD/character_table_model.h \
+    $$PWD/character_validation.h \
+    $$PWD/client_connection.h \
+    $$PWD/detail_prefetcher.h \
+    $$PWD/frame_buffer.h \
+    $$PWD/main_window.h \
+    $$PWD/protocol.h \
+    $$PWD/roster_exporter.h \
+    $$PWD/roster_stream_decoder.h \
+    $$PWD/server_link.h \
+    $$PWD/shared_memory_transport.h \
+    $$PWD/shared_ring.h \
+    $$PWD/timer_wheel.h \
+    $$PWD/transport.h
+
+FORMS += \
+    $$PWD/add_character_dialog.ui \
+    $$PWD/character_info_dialog.ui \
+    $$PWD/main_window.ui
@@ -0,0 +1,425 @@
+#include "character_table_model.h"
+
+#include <algorithm>
+#include <functional>
+#include <unordered_set>
+
+CharacterTableModel::CharacterTableModel(QObject* parent)
+    : QAbstractTableModel(parent)
+{
+}
+
+int CharacterTableModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : static_cast<int>(m_columns.size());
+}
+
+int CharacterTableModel::columnCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant CharacterTableModel::data(const QModelIndex& index, int role) const {
+    if (!index.isValid()) {
+        return QVariant();
+    }
+
+    const size_t row = static_cast<size_t>(index.row());
+    if (role == Qt::ToolTipRole && index.column() == ColumnBio && m_bioTruncated[row]) {
+        return QStringLiteral("Double-click to load the full bio");
+    }
+    if (role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    switch (index.column()) {
+    case ColumnId:
+        return QString::number(m_columns.ids[row]);
+    case ColumnName:
+        return QString::fromStdString(m_columns.names[row]);
+    case ColumnSurname:
+        return QString::fromStdString(m_columns.surnames[row]);
+    case ColumnAge:
+        return QString::number(m_columns.ages[row]);
+    case ColumnBio:
+        if (m_bioTruncated[row]) {
+            return QString::fromStdString(m_columns.bios[row]) + QStringLiteral("...");
+        }
+        return QString::fromStdString(m_columns.bios[row]);
+    default:
+        return QVariant();
+    }
+}
+
+QVariant CharacterTableModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+
+    switch (section) {
+    case ColumnId:
+        return QStringLiteral("ID");
+    case ColumnName:
+        return QStringLiteral("Name");
+    case ColumnSurname:
+        return QStringLiteral("Surname");
+    case ColumnAge:
+        return QStringLiteral("Age");
+    case ColumnBio:
+        return QStringLiteral("Bio");
+    default:
+        return QVariant();
+    }
+}
+
+void CharacterTableModel::setColumns(CharacterColumns columns, size_t bioPreviewLength) {
+    beginResetModel();
+    // Replaces whatever a refresh merged so far
+    m_refreshing = false;
+    m_pendingRows.clear();
+    m_columns = std::move(columns);
+    m_bioTruncated.assign(m_columns.size(), false);
+    for (size_t row = 0; row < m_columns.size(); ++row) {
+        m_bioTruncated[row] = trimPreview(m_columns.bios[row], bioPreviewLength);
+    }
+    rebuildIndex();
+    endResetModel();
+}
+
+void CharacterTableModel::setCharacters(const std::vector<CharacterData>& characters, size_t bioPreviewLength) {
+    CharacterColumns columns;
+    columns.reserve(characters.size());
+    for (const auto& character : characters) {
+        columns.append(character);
+    }
+    setColumns(std::move(columns), bioPreviewLength);
+}
+
+void CharacterTableModel::appendColumns(const CharacterColumns& columns, size_t bioPreviewLength) {
+    if (columns.size() == 0) {
+        return;
+    }
+
+    const size_t first = m_columns.size();
+    beginInsertRows(QModelIndex(), static_cast<int>(first), static_cast<int>(first + columns.size() - 1));
+    m_columns.extend(columns);
+    m_bioTruncated.resize(m_columns.size(), false);
+    m_rowById.reserve(m_columns.size());
+    for (size_t row = first; row < m_columns.size(); ++row) {
+        m_bioTruncated[row] = trimPreview(m_columns.bios[row], bioPreviewLength);
+        indexRow(m_columns.ids[row], static_cast<int>(row));
+    }
+    endInsertRows();
+}
+
+void CharacterTableModel::appendCharacters(const std::vector<CharacterData>& characters, size_t bioPreviewLength) {
+    CharacterColumns columns;
+    columns.reserve(characters.size());
+    for (const auto& character : characters) {
+        columns.append(character);
+    }
+    appendColumns(columns, bioPreviewLength);
+}
+
+void CharacterTableModel::beginRefresh(size_t bioPreviewLength) {
+    if (m_refreshing) {
+        endRefresh(false);
+    }
+
+    // Every row is pending until the roster reaches it
+    m_refreshing = true;
+    m_refreshBioLength = bioPreviewLength;
+    m_mergedRows = 0;
+    m_shift = 0;
+    m_pendingRows.swap(m_rowById);
+    m_rowById.clear();
+    m_rowById.reserve(m_pendingRows.size());
+}
+
+void CharacterTableModel::mergeColumns(const CharacterColumns& columns) {
+    if (!m_refreshing) {
+        return;
+    }
+
+    size_t insertFirst = 0;
+    size_t insertCount = 0;
+    // Ids of the run, not in m_rowById until it is flushed
+    std::unordered_set<int32_t> insertIds;
+    int changedFirst = -1;
+    int changedLast = -1;
+
+    auto flushChanged = [&]() {
+        if (changedFirst >= 0) {
+            emit dataChanged(index(changedFirst, ColumnName), index(changedLast, ColumnCount - 1));
+            changedFirst = -1;
+        }
+    };
+    auto flushInserted = [&]() {
+        if (insertCount != 0) {
+            insertMerged(columns, insertFirst, insertCount);
+            insertCount = 0;
+            insertIds.clear();
+        }
+    };
+
+    for (size_t i = 0; i < columns.size(); ++i) {
+        const int32_t id = columns.ids[i];
+        auto pending = m_pendingRows.find(id);
+        if (pending == m_pendingRows.end()) {
+            // Merged already or earlier in the run, the roster repeats an
+            // id, ends a run of new rows
+            if (m_rowById.count(id) != 0 || insertIds.count(id) != 0) {
+                flushInserted();
+                continue;
+            }
+            if (insertCount == 0) {
+                insertFirst = i;
+            }
+            insertIds.insert(id);
+            ++insertCount;
+            continue;
+        }
+        flushInserted();
+
+        // Rows between the merge position and the match are gone
+        const size_t row = static_cast<size_t>(pending->second + m_shift);
+        m_pendingRows.erase(pending);
+        if (row > m_mergedRows) {
+            flushChanged();
+            eraseRows(m_mergedRows, row - m_mergedRows);
+        }
+
+        m_rowById[id] = static_cast<int>(m_mergedRows);
+        if (mergeRow(m_mergedRows, columns, i)) {
+            const int merged = static_cast<int>(m_mergedRows);
+            if (changedFirst >= 0 && changedLast + 1 != merged) {
+                flushChanged();
+            }
+            if (changedFirst < 0) {
+                changedFirst = merged;
+            }
+            changedLast = merged;
+        }
+        ++m_mergedRows;
+    }
+    flushInserted();
+    flushChanged();
+}
+
+void CharacterTableModel::mergeCharacters(const std::vector<CharacterData>& characters) {
+    CharacterColumns columns;
+    columns.reserve(characters.size());
+    for (const auto& character : characters) {
+        columns.append(character);
+    }
+    mergeColumns(columns);
+}
+
+void CharacterTableModel::endRefresh(bool complete) {
+    if (!m_refreshing) {
+        return;
+    }
+
+    if (complete && m_mergedRows < m_columns.size()) {
+        eraseRows(m_mergedRows, m_columns.size() - m_mergedRows);
+    }
+    // Rows kept from the old roster go back to the main index
+    for (const auto& pending : m_pendingRows) {
+        m_rowById[pending.first] = static_cast<int>(pending.second + m_shift);
+    }
+    m_pendingRows.clear();
+    m_refreshing = false;
+}
+
+void CharacterTableModel::insertMerged(const CharacterColumns& source, size_t first, size_t count) {
+    const size_t row = m_mergedRows;
+    const auto from = static_cast<std::ptrdiff_t>(first);
+    const auto to = static_cast<std::ptrdiff_t>(first + count);
+    const auto at = static_cast<std::ptrdiff_t>(row);
+
+    beginInsertRows(QModelIndex(), static_cast<int>(row), static_cast<int>(row + count - 1));
+    m_columns.ids.insert(m_columns.ids.begin() + at, source.ids.begin() + from, source.ids.begin() + to);
+    m_columns.ages.insert(m_columns.ages.begin() + at, source.ages.begin() + from, source.ages.begin() + to);
+    m_columns.names.insert(m_columns.names.begin() + at, source.names.begin() + from, source.names.begin() + to);
+    m_columns.surnames.insert(m_columns.surnames.begin() + at, source.surnames.begin() + from, source.surnames.begin() + to);
+    m_columns.bios.insert(m_columns.bios.begin() + at, source.bios.begin() + from, source.bios.begin() + to);
+    m_bioTruncated.insert(m_bioTruncated.begin() + at, count, false);
+    for (size_t i = 0; i < count; ++i) {
+        m_bioTruncated[row + i] = trimPreview(m_columns.bios[row + i], m_refreshBioLength);
+        m_rowById[source.ids[first + i]] = static_cast<int>(row + i);
+    }
+    m_mergedRows += count;
+    m_shift += static_cast<long long>(count);
+    endInsertRows();
+}
+
+void CharacterTableModel::eraseRows(size_t first, size_t count) {
+    const size_t last = first + count;
+    // Outside a refresh every row is merged
+    const size_t merged = m_refreshing ? m_mergedRows : m_columns.size();
+
+    beginRemoveRows(QModelIndex(), static_cast<int>(first), static_cast<int>(last - 1));
+    for (size_t row = first; row < last; ++row) {
+        m_rowById.erase(m_columns.ids[row]);
+        m_pendingRows.erase(m_columns.ids[row]);
+    }
+    // Later rows move up, pending ones through m_shift unless some precede the range
+    const int moved = static_cast<int>(count);
+    for (size_t row = last; row < m_columns.size(); ++row) {
+        if (row < merged) {
+            m_rowById[m_columns.ids[row]] -= moved;
+        } else if (first > merged) {
+            m_pendingRows[m_columns.ids[row]] -= moved;
+        } else {
+            break;
+        }
+    }
+    if (m_refreshing) {
+        if (first <= merged) {
+            m_shift -= static_cast<long long>(count);
+        }
+        m_mergedRows -= std::min(last, merged) - std::min(first, merged);
+    }
+
+    const auto from = static_cast<std::ptrdiff_t>(first);
+    const auto to = static_cast<std::ptrdiff_t>(last);
+    m_columns.ids.erase(m_columns.ids.begin() + from, m_columns.ids.begin() + to);
+    m_columns.ages.erase(m_columns.ages.begin() + from, m_columns.ages.begin() + to);
+    m_columns.names.erase(m_columns.names.begin() + from, m_columns.names.begin() + to);
+    m_columns.surnames.erase(m_columns.surnames.begin() + from, m_columns.surnames.begin() + to);
+    m_columns.bios.erase(m_columns.bios.begin() + from, m_columns.bios.begin() + to);
+    m_bioTruncated.erase(m_bioTruncated.begin() + from, m_bioTruncated.begin() + to);
+    endRemoveRows();
+}
+
+bool CharacterTableModel::mergeRow(size_t row, const CharacterColumns& source, size_t index) {
+    bool changed = false;
+    auto assign = [&changed](auto& field, const auto& value) {
+        if (field != value) {
+            field = value;
+            changed = true;
+        }
+    };
+    assign(m_columns.names[row], source.names[index]);
+    assign(m_columns.surnames[row], source.surnames[index]);
+    assign(m_columns.ages[row], source.ages[index]);
+
+    std::string bio = source.bios[index];
+    const bool preview = trimPreview(bio, m_refreshBioLength);
+    // A full bio loaded on demand outlives a refresh that only brings its preview
+    const std::string& current = m_columns.bios[row];
+    if (preview && !m_bioTruncated[row] && current.compare(0, bio.size(), bio) == 0) {
+        return changed;
+    }
+    assign(m_columns.bios[row], bio);
+    if (m_bioTruncated[row] != preview) {
+        m_bioTruncated[row] = preview;
+        changed = true;
+    }
+    return changed;
+}
+
+bool CharacterTableModel::trimPreview(std::string& bio, size_t bioPreviewLength) {
+    // Up to the preview length they arrived whole
+    if (bioPreviewLength == 0 || bio.size() <= bioPreviewLength) {
+        return false;
+    }
+    // Never ends inside a multibyte character, continuation bytes are 10xxxxxx
+    size_t end = bioPreviewLength;
+    while (end > 0 && (static_cast<uint8_t>(bio[end]) & 0xC0) == 0x80) {
+        --end;
+    }
+    bio.resize(end);
+    return true;
+}
+
+void CharacterTableModel::upsertCharacter(const CharacterData& character) {
+    if (updateCharacter(character)) {
+        return;
+    }
+
+    int row = rowCount();
+    beginInsertRows(QModelIndex(), row, row);
+    m_columns.append(character);
+    m_bioTruncated.push_back(false);
+    indexRow(character.id, row);
+    endInsertRows();
+}
+
+bool CharacterTableModel::updateCharacter(const CharacterData& character) {
+    int row = rowForId(character.id);
+    if (row < 0) {
+        return false;
+    }
+
+    m_columns.names[row] = character.name;
+    m_columns.surnames[row] = character.surname;
+    m_columns.ages[row] = character.age;
+    m_columns.bios[row] = character.bio;
+    m_bioTruncated[row] = false;
+    emit dataChanged(index(row, ColumnName), index(row, ColumnCount - 1));
+    return true;
+}
+
+bool CharacterTableModel::isBioTruncated(int row) const {
+    return m_bioTruncated[static_cast<size_t>(row)];
+}
+
+void CharacterTableModel::removeCharacter(int id) {
+    int row = rowForId(id);
+    if (row >= 0) {
+        eraseRows(static_cast<size_t>(row), 1);
+    }
+}
+
+void CharacterTableModel::removeCharacters(const std::vector<int32_t>& ids) {
+    std::vector<size_t> rows;
+    rows.reserve(ids.size());
+    for (int32_t id : ids) {
+        int row = rowForId(id);
+        if (row >= 0) {
+            rows.push_back(static_cast<size_t>(row));
+        }
+    }
+    // From the bottom up, rows above a removed run keep their numbers
+    std::sort(rows.begin(), rows.end(), std::greater<size_t>());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+    size_t run = 0;
+    while (run < rows.size()) {
+        size_t end = run + 1;
+        while (end < rows.size() && rows[end] + 1 == rows[end - 1]) {
+            ++end;
+        }
+        eraseRows(rows[end - 1], end - run);
+        run = end;
+    }
+}
+
+int CharacterTableModel::rowForId(int id) const {
+    auto it = m_rowById.find(id);
+    if (it != m_rowById.end()) {
+        return it->second;
+    }
+    auto pending = m_pendingRows.find(id);
+    return pending == m_pendingRows.end() ? -1 : static_cast<int>(pending->second + m_shift);
+}
+
+int CharacterTableModel::idAt(int row) const {
+    return m_columns.ids[static_cast<size_t>(row)];
+}
+
+void CharacterTableModel::rebuildIndex() {
+    m_rowById.clear();
+    m_pendingRows.clear();
+    m_shift = 0;
+    m_rowById.reserve(m_columns.size());
+    for (size_t row = 0; row < m_columns.size(); ++row) {
+        indexRow(m_columns.ids[row], static_cast<int>(row));
+    }
+}
+
+void CharacterTableModel::indexRow(int32_t id, int row) {
+    if (m_refreshing && static_cast<size_t>(row) >= m_mergedRows) {
+        m_pendingRows[id] = static_cast<int>(row - m_shift);
+        return;
+    }
+    m_rowById[id] = row;
+}
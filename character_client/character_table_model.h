@@ -0,0 +1,227 @@
+/**
+ * \file character_table_model.h
+ * \brief Table model backed by columnar character storage
+ */
+
+#ifndef CHARACTER_TABLE_MODEL_H
+#define CHARACTER_TABLE_MODEL_H
+
+#include <QAbstractTableModel>
+#include <unordered_map>
+#include "protocol.h"
+
+/**
+ * \class CharacterTableModel
+ * \brief Read-only table model over CharacterColumns
+ *
+ * \details Keeps the roster as struct-of-arrays, the same layout the
+ * server sends for Protocol::GET_ALL_COLUMNAR, and keeps an id to row
+ * index so single records can be patched without a scan.
+ *
+ * A refresh is merged into the current rows by id, chunk by chunk as the
+ * roster arrives, see beginRefresh(). Only rows that were added, removed
+ * or changed are signalled, so views keep their selection and scroll
+ * position and repaint only what changed.
+ */
+class CharacterTableModel : public QAbstractTableModel {
+    Q_OBJECT
+
+public:
+    /**
+     * \brief Table columns
+     */
+    enum Column {
+        ColumnId,
+        ColumnName,
+        ColumnSurname,
+        ColumnAge,
+        ColumnBio,
+        ColumnCount
+    };
+
+    /**
+     * \brief Constructs an empty model
+     * \param parent Optional QObject parent
+     */
+    explicit CharacterTableModel(QObject* parent = nullptr);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    /**
+     * \brief Replaces the whole roster
+     * \param columns New roster, taken over by the model
+     * \param bioPreviewLength Preview length, the roster was loaded with one more byte, 0 for whole bios
+     */
+    void setColumns(CharacterColumns columns, size_t bioPreviewLength = 0);
+
+    /**
+     * \brief Replaces the whole roster from row-wise records
+     * \param characters New roster
+     * \param bioPreviewLength Preview length, the roster was loaded with one more byte, 0 for whole bios
+     */
+    void setCharacters(const std::vector<CharacterData>& characters, size_t bioPreviewLength = 0);
+
+    /**
+     * \brief Appends rows at the end, for rosters loaded in chunks
+     * \param columns Rows to append
+     * \param bioPreviewLength Preview length, the roster is loaded with one more byte, 0 for whole bios
+     */
+    void appendColumns(const CharacterColumns& columns, size_t bioPreviewLength = 0);
+
+    /**
+     * \brief Appends row-wise records at the end, for rosters loaded in chunks
+     * \param characters Records to append
+     * \param bioPreviewLength Preview length, the roster is loaded with one more byte, 0 for whole bios
+     */
+    void appendCharacters(const std::vector<CharacterData>& characters, size_t bioPreviewLength = 0);
+
+    /**
+     * \brief Starts merging a fresh roster into the current rows
+     * \param bioPreviewLength Preview length, the roster is loaded with one more byte, 0 for whole bios
+     *
+     * \note Feed the roster in server order with mergeColumns() or
+     * mergeCharacters(), then call endRefresh(). A refresh already under
+     * way is ended as incomplete
+     */
+    void beginRefresh(size_t bioPreviewLength = 0);
+
+    /**
+     * \brief Merges the next rows of the roster being refreshed
+     * \param columns Rows following those merged so far
+     *
+     * \details Rows are matched by id. Unchanged rows emit nothing,
+     * changed ones dataChanged(), new ones rowsInserted() and rows the
+     * roster skipped over rowsRemoved(), each coalesced into ranges
+     */
+    void mergeColumns(const CharacterColumns& columns);
+
+    /**
+     * \brief Merges the next row-wise records of the roster being refreshed
+     * \param characters Records following those merged so far
+     * \see mergeColumns()
+     */
+    void mergeCharacters(const std::vector<CharacterData>& characters);
+
+    /**
+     * \brief Ends the refresh started by beginRefresh()
+     * \param complete True if the whole roster was merged, rows it did not
+     * contain are removed then. False keeps them, for failed transfers
+     */
+    void endRefresh(bool complete);
+
+    /**
+     * \brief Returns whether a refresh is being merged
+     * \return bool True between beginRefresh() and endRefresh()
+     */
+    bool isRefreshing() const { return m_refreshing; }
+
+    /**
+     * \brief Updates the row with the same id or appends a new one
+     * \param character Full character record to store
+     */
+    void upsertCharacter(const CharacterData& character);
+
+    /**
+     * \brief Updates the row with the same id, if any
+     * \param character Full character record to store
+     * \return bool True if a row was updated
+     */
+    bool updateCharacter(const CharacterData& character);
+
+    /**
+     * \brief Returns whether a row only holds a bio preview
+     * \param row Row index
+     * \return bool True if the full bio has not been loaded
+     */
+    bool isBioTruncated(int row) const;
+
+    /**
+     * \brief Removes the row with the given id, if any
+     * \param id Character ID to remove
+     */
+    void removeCharacter(int id);
+
+    /**
+     * \brief Removes the rows with the given ids, missing ones are skipped
+     * \param ids Character IDs to remove
+     *
+     * \note Each run of adjacent rows goes in one removal
+     */
+    void removeCharacters(const std::vector<int32_t>& ids);
+
+    /**
+     * \brief Returns the row holding a character
+     * \param id Character ID
+     * \return int Row index, -1 if not present
+     */
+    int rowForId(int id) const;
+
+    /**
+     * \brief Returns the character ID stored in a row
+     * \param row Row index
+     * \return int Character ID
+     */
+    int idAt(int row) const;
+
+private:
+    /**
+     * \brief Rebuilds the id to row index from the id column
+     *
+     * \note During a refresh, rows not merged yet go to the pending index
+     */
+    void rebuildIndex();
+
+    /**
+     * \brief Records the row of a character in the right index
+     * \param id Character ID
+     * \param row Current row
+     */
+    void indexRow(int32_t id, int row);
+
+    /**
+     * \brief Cuts a bio loaded past its preview down to the preview
+     * \param bio Bio as loaded, left with whole UTF-8 characters only
+     * \param bioPreviewLength Preview length, 0 for whole bios
+     * \return bool True if the bio was truncated
+     */
+    static bool trimPreview(std::string& bio, size_t bioPreviewLength);
+
+    /**
+     * \brief Inserts consecutive rows of a refresh at the merge position
+     * \param source Roster chunk being merged
+     * \param first First row of the chunk to insert
+     * \param count Number of rows
+     */
+    void insertMerged(const CharacterColumns& source, size_t first, size_t count);
+
+    /**
+     * \brief Removes consecutive rows, moving the index of later rows up
+     * \param first First row to remove
+     * \param count Number of rows, at least 1
+     */
+    void eraseRows(size_t first, size_t count);
+
+    /**
+     * \brief Stores a refreshed record over the row it matched
+     * \param row Row at the merge position
+     * \param source Roster chunk being merged
+     * \param index Row of the chunk
+     * \return bool True if anything visible changed
+     */
+    bool mergeRow(size_t row, const CharacterColumns& source, size_t index);
+
+    CharacterColumns m_columns;                   ///< Roster storage
+    std::vector<bool> m_bioTruncated;             ///< Per row, bio is a preview
+    std::unordered_map<int32_t, int> m_rowById;   ///< Character ID to row, merged rows only during a refresh
+
+    bool m_refreshing = false;                    ///< A refresh is being merged
+    size_t m_refreshBioLength = 0;                ///< Bio length of the refreshed roster
+    size_t m_mergedRows = 0;                      ///< Rows before this one are merged
+    std::unordered_map<int32_t, int> m_pendingRows; ///< Rows not merged yet, by ID, row before m_shift
+    long long m_shift = 0;                        ///< Rows inserted minus removed since m_pendingRows was built
+};
+
+#endif // CHARACTER_TABLE_MODEL_H
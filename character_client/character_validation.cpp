@@ -0,0 +1,12 @@
+#include "character_validation.h"
+
+#include <QRegularExpression>
+
+bool CharacterValidation::isValidName(const QString& name) {
+    static const QRegularExpression nameRegex(namePattern());
+    return !name.isEmpty() && name.size() <= MAX_NAME_LENGTH && name.contains(nameRegex);
+}
+
+bool CharacterValidation::isValidAge(int age) {
+    return age >= MIN_AGE && age <= MAX_AGE;
+}
@@ -0,0 +1,37 @@
+/**
+ * \file character_validation.h
+ * \brief Input rules for character records entered or imported by users
+ */
+
+#ifndef CHARACTER_VALIDATION_H
+#define CHARACTER_VALIDATION_H
+
+#include <QString>
+
+namespace CharacterValidation {
+constexpr int MAX_NAME_LENGTH = 50; ///< Maximum length of first name and surname
+constexpr int MIN_AGE = 1; ///< Youngest accepted age
+constexpr int MAX_AGE = 179; ///< Oldest accepted age
+
+/**
+ * \brief Pattern a first name or surname must match
+ * \return const char* Regular expression source
+ */
+inline const char* namePattern() { return "^[a-zA-Z ]+$"; }
+
+/**
+ * \brief Validates a first name or surname
+ * \param name Name to validate
+ * \return bool True if non-empty, short enough and letters or spaces only
+ */
+bool isValidName(const QString& name);
+
+/**
+ * \brief Validates an age
+ * \param age Age to validate
+ * \return bool True if within [MIN_AGE, MAX_AGE]
+ */
+bool isValidAge(int age);
+}
+
+#endif // CHARACTER_VALIDATION_H
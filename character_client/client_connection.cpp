@@ -1,171 +1,769 @@
 #include "client_connection.h"
-#include <stdexcept>
-#include <cstring>
 
-#include <QHostAddress>
+#include <QStringList>
+#include <algorithm>
+
+namespace {
+// Wheel keys, each request has a deadline and possibly a hedge timer,
+// a stream under way an inactivity timer instead
+enum TimerKind : uint64_t {
+    TIMER_DEADLINE,
+    TIMER_HEDGE,
+    TIMER_STREAM,
+    TIMER_KINDS
+};
+
+uint64_t deadline_key(int ticket) {
+    return static_cast<uint64_t>(ticket) * TIMER_KINDS + TIMER_DEADLINE;
+}
+
+uint64_t hedge_key(int ticket) {
+    return static_cast<uint64_t>(ticket) * TIMER_KINDS + TIMER_HEDGE;
+}
+
+uint64_t stream_key(int streamId) {
+    return static_cast<uint64_t>(streamId) * TIMER_KINDS + TIMER_STREAM;
+}
+
+bool is_read(uint8_t command) {
+    return command == Protocol::GET_ONE || command == Protocol::GET_ALL
+            || command == Protocol::GET_ALL_COLUMNAR || command == Protocol::STATS
+            || command == Protocol::QUERY;
+}
+
+// Protocol::FEATURE_* flags a server needs to answer a command
+uint32_t required_features(uint8_t command) {
+    switch (command) {
+    case Protocol::QUERY:
+        return Protocol::FEATURE_QUERY;
+    case Protocol::STATS:
+        return Protocol::FEATURE_STATS;
+    default:
+        return 0;
+    }
+}
+
+bool is_mutation(uint8_t command) {
+    return command == Protocol::ADD_CHARACTER || command == Protocol::ADD_CHARACTERS
+            || command == Protocol::UPDATE_CHARACTER || command == Protocol::REMOVE_CHARACTER;
+}
+}
 
 ClientConnection::ClientConnection(QObject* parent)
-    : QObject(parent), m_socket(new QTcpSocket(this))
+    : QObject(parent),
+      m_wheel(WHEEL_TICK_MS, WHEEL_SLOTS),
+      m_wheelTimer(new QTimer(this))
 {
-    connect(m_socket, &QTcpSocket::connected, this, &ClientConnection::slotConnected);
-    connect(m_socket, &QTcpSocket::disconnected, this, &ClientConnection::slotDisconnected);
-    connect(m_socket, &QTcpSocket::readyRead, this, &ClientConnection::slotReadyRead);
-// In Qt 5.14 and earlier there is signal error(), no errorOccured
-    connect(m_socket, QOverload<QAbstractSocket::SocketError>::of(&QAbstractSocket::errorOccurred),
-            this, &ClientConnection::slotError);
+    m_wheelTimer->setInterval(static_cast<int>(WHEEL_TICK_MS));
+    connect(m_wheelTimer, &QTimer::timeout, this, &ClientConnection::slotWheelTick);
+    m_clock.start();
 }
 
-ClientConnection::~ClientConnection() {
-    m_socket->disconnectFromHost();
+std::vector<ClientConnection::Endpoint> ClientConnection::parseEndpoints(const QString& list) {
+    std::vector<Endpoint> endpoints;
+    for (const QString& entry : list.split(',', Qt::SkipEmptyParts)) {
+        const QString trimmed = entry.trimmed();
+        if (trimmed.isEmpty()) {
+            continue;
+        }
+
+        Endpoint endpoint;
+        endpoint.host = trimmed;
+        const int scheme = trimmed.indexOf(':');
+        const QString kind = scheme > 0 ? trimmed.left(scheme).toLower() : QString();
+        if (kind == "local" || kind == "unix" || kind == "shm") {
+            // Same host, the rest names the socket, "//" of a URI aside
+            endpoint.transport = (kind == "shm") ? Transport::Kind::SharedMemory : Transport::Kind::Local;
+            endpoint.host = trimmed.mid(scheme + 1);
+            if (endpoint.host.startsWith("//")) {
+                endpoint.host = endpoint.host.mid(2);
+            }
+        } else {
+            if (kind == "tcp" && trimmed.mid(scheme + 1).startsWith("//")) {
+                endpoint.host = trimmed.mid(scheme + 3);
+            }
+            const int colon = endpoint.host.lastIndexOf(':');
+            if (colon > 0) {
+                bool ok = false;
+                const uint port = endpoint.host.mid(colon + 1).toUInt(&ok);
+                endpoint.host = endpoint.host.left(colon);
+                if (ok && port > 0 && port <= 0xFFFF) {
+                    endpoint.port = static_cast<quint16>(port);
+                }
+            }
+        }
+        if (endpoint.host.isEmpty()) {
+            continue;
+        }
+        endpoint.role = endpoints.empty() ? Endpoint::Role::Primary : Endpoint::Role::Replica;
+        endpoints.push_back(endpoint);
+    }
+    return endpoints;
 }
 
 void ClientConnection::connectToServer(const QString& host) {
-    m_socket->connectToHost(host, Protocol::PORT);
+    Endpoint endpoint;
+    endpoint.host = host;
+    connectToServers({endpoint});
 }
 
-std::vector<uint8_t> ClientConnection::serializeId(int id) {
-    std::vector<uint8_t> data(sizeof(id));
-    std::memcpy(data.data(), &id, sizeof(id));
-    return data;
+void ClientConnection::connectToServers(const std::vector<Endpoint>& endpoints) {
+    clearLinks();
+    for (const auto& endpoint : endpoints) {
+        ServerLink* link = addLink(endpoint);
+        if (endpoint.role == Endpoint::Role::Primary && !m_primary) {
+            m_primary = link;
+        }
+    }
+    for (ServerLink* link : m_links) {
+        link->open();
+    }
 }
 
-bool ClientConnection::findMessageBoundary(size_t &pos)
-{
-    using namespace Protocol;
-// Search for CRLF sequence
-    auto it = std::search(
-                m_buffer.begin(), m_buffer.end(),
-                Protocol::MESSAGE_DELIMITER.begin(), Protocol::MESSAGE_DELIMITER.end()
-                );
-// Change the pos to next iteration
-    if (it != m_buffer.end()) {
-        pos = std::distance(m_buffer.begin(), it);
-        return true;
+ServerLink* ClientConnection::addLink(const Endpoint& endpoint) {
+    ServerLink* link = new ServerLink(endpoint.transport, endpoint.host, endpoint.port, this);
+    link->setMaxFrameSize(m_maxFrameSize);
+    link->setReadBufferSize(m_readBufferSize);
+    if (m_readPaused) {
+        link->pauseReading();
     }
-    return false;
+    m_links.push_back(link);
+
+    // Link state
+    connect(
+                link, &ServerLink::signalConnectionEstablished,
+                this, [this, link]() { linkReady(link); }
+                );
+    connect(
+                link, &ServerLink::signalConnectionFailed,
+                this, [this, link](const QString& error) { linkFailed(link, error); }
+                );
+    connect(
+                link, &ServerLink::signalDisconnected,
+                this, [this, link](const std::vector<ServerLink::Request>& lost) { linkDisconnected(link, lost); }
+                );
+    connect(
+                link, &ServerLink::signalRequestAnswered,
+                this, [this, link](int ticket) { linkAnswered(link, ticket); }
+                );
+
+    // Answers, request IDs are unique across links
+    connect(link, &ServerLink::signalCharactersReceived, this, &ClientConnection::signalCharactersReceived);
+    connect(link, &ServerLink::signalColumnsReceived, this, &ClientConnection::signalColumnsReceived);
+    connect(link, &ServerLink::signalCharactersChunk, this, &ClientConnection::signalCharactersChunk);
+    connect(link, &ServerLink::signalColumnsChunk, this, &ClientConnection::signalColumnsChunk);
+    connect(
+                link, &ServerLink::signalStreamFinished,
+                this, [this](int streamId, bool success, const QString& message) {
+                    streamEnded(streamId);
+                    emit signalStreamFinished(streamId, success, message);
+                }
+                );
+    connect(link, &ServerLink::signalCharacterReceived, this, &ClientConnection::signalCharacterReceived);
+    connect(link, &ServerLink::signalCharacterPrefetched, this, &ClientConnection::signalCharacterPrefetched);
+    connect(link, &ServerLink::signalPrefetchFailed, this, &ClientConnection::signalPrefetchFailed);
+    connect(link, &ServerLink::signalStatsReceived, this, &ClientConnection::signalStatsReceived);
+    connect(link, &ServerLink::signalStatsFailed, this, &ClientConnection::signalStatsFailed);
+    connect(link, &ServerLink::signalBatchCompleted, this, &ClientConnection::signalBatchCompleted);
+    connect(link, &ServerLink::signalOperationCompleted, this, &ClientConnection::signalOperationCompleted);
+
+    // Notifications, only from the subscribed link so none arrives twice
+    connect(
+                link, &ServerLink::signalSubscriptionChanged,
+                this, [this, link](bool active) {
+                    if (link == m_subscriptionLink) {
+                        emit signalSubscriptionChanged(active);
+                    }
+                }
+                );
+    connect(
+                link, &ServerLink::signalCharactersChanged,
+                this, [this, link](const std::vector<CharacterData>& characters) {
+                    if (link == m_subscriptionLink) {
+                        emit signalCharactersChanged(characters);
+                    }
+                }
+                );
+    connect(
+                link, &ServerLink::signalCharactersRemoved,
+                this, [this, link](const std::vector<int32_t>& ids) {
+                    if (link == m_subscriptionLink) {
+                        emit signalCharactersRemoved(ids);
+                    }
+                }
+                );
+    return link;
 }
 
-void ClientConnection::getAllCharacters() {
-    sendRequest(Protocol::GET_ALL);
-    m_expectedResponse = Protocol::GET_ALL;
+void ClientConnection::clearLinks() {
+    bool report = false;
+    while (!m_requests.empty()) {
+        report |= failRequest(m_requests.begin()->first, "Disconnected from server");
+    }
+    if (report) {
+        emit signalOperationCompleted(false, "Disconnected from server");
+    }
+
+    for (ServerLink* link : m_links) {
+        // Nothing it reports matters anymore
+        disconnect(link, nullptr, this, nullptr);
+        link->close();
+        link->deleteLater();
+    }
+    m_links.clear();
+    for (const auto& stream : m_streams) {
+        m_wheel.cancel(stream_key(stream.first));
+    }
+    m_streams.clear();
+    m_primary = nullptr;
+    m_subscriptionLink = nullptr;
+    m_primaryFailureReported = false;
 }
 
-void ClientConnection::getCharacter(int id) {
-    sendRequest(Protocol::GET_ONE, serializeId(id));
-    m_expectedResponse = Protocol::GET_ONE;
+ServerLink* ClientConnection::readLink(uint32_t requiredFeatures, const ServerLink* exclude) const {
+    auto usable = [requiredFeatures, exclude](const ServerLink* link) {
+        return link && link != exclude && link->isReady()
+                && (link->features() & requiredFeatures) == requiredFeatures;
+    };
+
+    // Replicas may not have the client's own writes yet
+    if (m_primary && m_lastWriteMs >= 0 && m_clock.elapsed() - m_lastWriteMs < READ_YOUR_WRITES_MS) {
+        if (m_primary == exclude) {
+            return nullptr;
+        }
+        if (usable(m_primary)) {
+            return m_primary;
+        }
+    }
+
+    ServerLink* best = nullptr;
+    double bestRtt = 0.0;
+    for (ServerLink* link : m_links) {
+        if (link == m_primary || !usable(link)) {
+            continue;
+        }
+        // A replica without a recent sample gets the next read, which measures it
+        const qint64 age = link->msSinceRttSample();
+        const double rtt = (age < 0 || age > RTT_STALE_MS) ? 0.0 : link->rttMs();
+        if (!best || rtt < bestRtt) {
+            best = link;
+            bestRtt = rtt;
+        }
+    }
+    if (best) {
+        return best;
+    }
+    return usable(m_primary) ? m_primary : nullptr;
 }
 
-void ClientConnection::slotRemoveCharacter(int id) {
-    sendRequest(Protocol::REMOVE_CHARACTER, serializeId(id));
-    m_expectedResponse = Protocol::REMOVE_CHARACTER;
+bool ClientConnection::isConnected() const {
+    return std::any_of(m_links.begin(), m_links.end(),
+                       [](const ServerLink* link) { return link->isReady(); });
 }
 
-void ClientConnection::slotUpdateCharacter(const CharacterData& character) {
-    sendRequest(Protocol::UPDATE_CHARACTER, character.serialize());
-    m_expectedResponse = Protocol::UPDATE_CHARACTER;
+uint32_t ClientConnection::features() const {
+    const ServerLink* link = readLink();
+    return link ? link->features() : 0;
 }
 
-void ClientConnection::addCharacter(const CharacterData& character) {
-    sendRequest(Protocol::ADD_CHARACTER, character.serialize());
-    m_expectedResponse = Protocol::ADD_CHARACTER;
+void ClientConnection::linkReady(ServerLink* link) {
+    if (link == m_primary) {
+        m_primaryFailureReported = false;
+    }
+    // Owners subscribe in response, the primary is preferred as replicas may lag
+    if (!m_subscriptionLink || (link == m_primary && m_subscriptionLink != m_primary)) {
+        emit signalConnectionEstablished();
+    }
 }
 
-void ClientConnection::sendRequest(uint8_t command, const std::vector<uint8_t>& data) {
-    m_lastCommand = command;
-    if (m_socket->state() != QAbstractSocket::ConnectedState) {
-        emit signalOperationCompleted(false, "Not connected to server");
+void ClientConnection::linkFailed(ServerLink* link, const QString& error) {
+    // Replicas retry quietly, reads simply go elsewhere meanwhile
+    if (link != m_primary || m_primaryFailureReported) {
         return;
     }
+    m_primaryFailureReported = true;
+    emit signalConnectionFailed(error);
+}
 
-    // Prepend command byte
-    std::vector<uint8_t> packet;
-    // 1 for command
-    packet.reserve(1 + data.size() + Protocol::MESSAGE_DELIMITER_SIZE);
-    packet.push_back(command);
-    packet.insert(packet.end(), data.begin(), data.end());
+void ClientConnection::linkDisconnected(ServerLink* link, const std::vector<ServerLink::Request>& lost) {
+    bool report = false;
+    for (const auto& request : lost) {
+        auto it = m_requests.find(request.ticket);
+        if (it == m_requests.end()) {
+            continue;
+        }
+        TrackedRequest& tracked = it->second;
 
-    packet.insert(packet.end(), Protocol::MESSAGE_DELIMITER.begin(), Protocol::MESSAGE_DELIMITER.end());
+        // The other copy of a hedged read is still out
+        if (link == tracked.hedgeLink) {
+            tracked.hedgeLink = nullptr;
+            continue;
+        }
+        if (tracked.hedgeLink) {
+            tracked.link = tracked.hedgeLink;
+            tracked.sentAtMs = tracked.hedgeSentAtMs;
+            tracked.hedgeLink = nullptr;
+            continue;
+        }
 
-    m_socket->write(reinterpret_cast<const char*>(packet.data()), packet.size());
-    m_socket->flush();
+        // Resending a mutation could apply it twice, its owner decides
+        // Only to a server that can answer it, an older replica would refuse
+        ServerLink* target = is_read(request.command) ? readLink(required_features(request.command)) : nullptr;
+        if (target) {
+            tracked.link = target;
+            target->resend(request);
+            continue;
+        }
+        report |= failRequest(request.ticket, "Disconnected from server");
+    }
+
+    if (link == m_subscriptionLink) {
+        m_subscriptionLink = nullptr;
+        // Changes are missed until a new subscription, owners renew it
+        if (isConnected()) {
+            emit signalConnectionEstablished();
+        }
+    }
+    if (report || !isConnected()) {
+        emit signalOperationCompleted(false, "Disconnected from server");
+    }
+}
+
+int ClientConnection::track(ServerLink* link, ServerLink::Request request) {
+    const int ticket = m_nextRequestId++;
+    request.ticket = ticket;
+    // Streams are named by their request ID
+    if (request.streamId != 0) {
+        request.streamId = ticket;
+    }
+
+    TrackedRequest tracked;
+    tracked.request = request;
+    tracked.link = link;
+    tracked.sentAtMs = m_clock.elapsed();
+    m_requests[ticket] = tracked;
+    if (is_mutation(request.command)) {
+        m_lastWriteMs = tracked.sentAtMs;
+    }
+
+    arm(deadline_key(ticket), timeoutFor(request.command));
+    // Hedging only helps if another server can answer meanwhile
+    if (m_hedgedReads && request.command == Protocol::GET_ONE && readLink(0, link)) {
+        const int delay = hedgeDelayMs();
+        if (delay >= 0) {
+            arm(hedge_key(ticket), delay);
+        }
+    }
+    return ticket;
 }
 
-void ClientConnection::slotConnected() {
-    emit signalConnectionEstablished();
+void ClientConnection::linkAnswered(ServerLink* link, int ticket) {
+    auto it = m_requests.find(ticket);
+    if (it == m_requests.end()) {
+        return;
+    }
+    const TrackedRequest tracked = it->second;
+    m_requests.erase(it);
+    m_wheel.cancel(deadline_key(ticket));
+    m_wheel.cancel(hedge_key(ticket));
+
+    // The read-your-writes window runs from the acknowledgement
+    if (is_mutation(tracked.request.command)) {
+        m_lastWriteMs = m_clock.elapsed();
+    }
+    if (tracked.request.command == Protocol::GET_ONE) {
+        const qint64 sentAt = (link == tracked.hedgeLink) ? tracked.hedgeSentAtMs : tracked.sentAtMs;
+        const qint64 latency = m_clock.elapsed() - sentAt;
+        if (m_latencies.size() < LATENCY_SAMPLES) {
+            m_latencies.push_back(latency);
+        } else {
+            m_latencies[m_nextLatency] = latency;
+        }
+        m_nextLatency = (m_nextLatency + 1) % LATENCY_SAMPLES;
+    }
+
+    // Timed by its link's activity from now on, until it ends
+    if (tracked.request.streamId != 0) {
+        m_streams[ticket] = link;
+        arm(stream_key(ticket), m_readTimeoutMs);
+    }
+
+    // First answer wins, the slower copy's is dropped on arrival
+    ServerLink* other = (link == tracked.link) ? tracked.hedgeLink : tracked.link;
+    if (other) {
+        other->cancel(ticket);
+    }
 }
 
-void ClientConnection::slotDisconnected() {
-    emit signalOperationCompleted(false, "Disconnected from server");
+bool ClientConnection::failRequest(int ticket, const QString& message) {
+    auto it = m_requests.find(ticket);
+    if (it == m_requests.end()) {
+        return false;
+    }
+    const ServerLink::Request request = it->second.request;
+    m_requests.erase(it);
+    m_wheel.cancel(deadline_key(ticket));
+    m_wheel.cancel(hedge_key(ticket));
+
+    if (request.streamId != 0) {
+        emit signalStreamFinished(request.streamId, false, message);
+        return false;
+    }
+    if (request.batchSize != 0) {
+        emit signalBatchCompleted(0, request.batchSize);
+        return false;
+    }
+    if (request.command == Protocol::GET_ONE && request.background) {
+        emit signalPrefetchFailed(request.id);
+        return false;
+    }
+    if (request.command == Protocol::STATS) {
+        emit signalStatsFailed(message);
+        return false;
+    }
+    // Renewed through signalConnectionEstablished() or signalSubscriptionChanged()
+    if (request.command == Protocol::SUBSCRIBE) {
+        return false;
+    }
+    return true;
 }
 
-void ClientConnection::slotReadyRead() {
-    QByteArray newData = m_socket->readAll();
-    m_buffer.insert(m_buffer.end(), newData.begin(), newData.end());
+void ClientConnection::expireRequest(int ticket) {
+    auto it = m_requests.find(ticket);
+    if (it == m_requests.end()) {
+        return;
+    }
+    const TrackedRequest tracked = it->second;
+    const int timeout = timeoutFor(tracked.request.command);
 
-    size_t pos = 0;
+    for (ServerLink* link : {tracked.link, tracked.hedgeLink}) {
+        if (link) {
+            link->cancel(ticket);
+        }
+    }
+    if (failRequest(ticket, "Request timed out")) {
+        emit signalOperationCompleted(false, "Request timed out");
+    }
+    if (tracked.request.command == Protocol::SUBSCRIBE && tracked.link == m_subscriptionLink) {
+        // Owners fall back to refreshing on their own
+        emit signalSubscriptionChanged(false);
+    }
 
-    // taking into account TCP messages framing and stacking
-    while (findMessageBoundary(pos)) {
-        std::vector<uint8_t> message(m_buffer.begin(), m_buffer.begin() + pos);
-        processResponse(message);
-        // Remove message + CRLF
-        m_buffer.erase(m_buffer.begin(), m_buffer.begin() + pos + Protocol::MESSAGE_DELIMITER_SIZE);
-        // Reset for next search
-        pos = 0;
+    // Silent for a whole deadline, whatever else it holds is stuck too
+    if (tracked.link && tracked.link->isReady() && tracked.link->msSinceActivity() >= timeout) {
+        tracked.link->restart("Server stopped responding");
     }
 }
 
-void ClientConnection::processResponse(const std::vector<uint8_t>& data) {
-    if (data.empty()) {
-        emit signalOperationCompleted(false, "Empty response from server");
+void ClientConnection::expireStream(int streamId) {
+    auto it = m_streams.find(streamId);
+    if (it == m_streams.end()) {
+        return;
+    }
+    ServerLink* link = it->second;
+
+    // Rearmed from the last received chunk while the payload keeps coming
+    const qint64 idleMs = link->msSinceActivity();
+    if (idleMs < m_readTimeoutMs) {
+        arm(stream_key(streamId), m_readTimeoutMs - idleMs);
         return;
     }
+    // Stalled mid-payload, dropping the link fails the stream
+    m_streams.erase(it);
+    link->restart("Server stopped responding");
+}
 
-    uint8_t responseType = data[0];
-    std::vector<uint8_t> payload(data.begin() + 1, data.end());
+void ClientConnection::streamEnded(int streamId) {
+    if (m_streams.erase(streamId) != 0) {
+        m_wheel.cancel(stream_key(streamId));
+    }
+}
 
-    if (responseType == Protocol::RESP_ERROR) {
-        emit signalOperationCompleted(false, "Server returned error");
+void ClientConnection::hedgeRequest(int ticket) {
+    auto it = m_requests.find(ticket);
+    if (it == m_requests.end() || it->second.hedgeLink) {
+        return;
+    }
+    TrackedRequest& tracked = it->second;
+    ServerLink* target = readLink(0, tracked.link);
+    if (!target) {
         return;
     }
 
-    try {
-        switch (responseType) {
-        case Protocol::GET_ALL:
-            if (payload.size() == 0) {
-                emit signalOperationCompleted(false, "Empty db");
-                break;
-            }
-            emit signalCharactersReceived(CharacterData::deserializeVector(payload));
-            break;
+    tracked.hedgeLink = target;
+    tracked.hedgeSentAtMs = m_clock.elapsed();
+    ++m_hedgesSent;
+    target->getCharacter(tracked.request.id, tracked.request.background, ticket);
+}
 
-        case Protocol::GET_ONE:
-            emit signalCharacterReceived(CharacterData::deserialize(payload));
-            break;
+int ClientConnection::hedgeDelayMs() const {
+    if (m_latencies.size() < MIN_LATENCY_SAMPLES) {
+        return -1;
+    }
+    std::vector<qint64> sorted = m_latencies;
+    auto p95 = sorted.begin() + static_cast<std::ptrdiff_t>(sorted.size() * 95 / 100);
+    std::nth_element(sorted.begin(), p95, sorted.end());
+    return static_cast<int>(std::max<qint64>(*p95, 1));
+}
 
-        case Protocol::ADD_CHARACTER:
-            emit signalOperationCompleted(true, "Add successful");
-            break;
-        case Protocol::UPDATE_CHARACTER:
-            emit signalOperationCompleted(true, "Update successful");
-            break;
-        case Protocol::REMOVE_CHARACTER:
-            emit signalOperationCompleted(true, "Remove successful");
-            break;
+void ClientConnection::arm(uint64_t key, qint64 delayMs) {
+    m_wheel.schedule(key, m_clock.elapsed(), delayMs);
+    if (!m_wheelTimer->isActive()) {
+        m_wheelTimer->start();
+    }
+}
 
-        case Protocol::RESP_SUCCESS:
-            emit signalOperationCompleted(true, "Operation successful");
+void ClientConnection::slotWheelTick() {
+    std::vector<uint64_t> expired;
+    m_wheel.advance(m_clock.elapsed(), expired);
+    for (uint64_t key : expired) {
+        const int ticket = static_cast<int>(key / TIMER_KINDS);
+        switch (key % TIMER_KINDS) {
+        case TIMER_HEDGE:
+            hedgeRequest(ticket);
+            break;
+        case TIMER_STREAM:
+            expireStream(ticket);
             break;
-
         default:
-            emit signalOperationCompleted(false, "Unknown response type");
+            expireRequest(ticket);
         }
-    } catch (const std::exception& e) {
-        emit signalOperationCompleted(false, QString("Processing error: %1").arg(e.what()));
+    }
+    // No wakeups while nothing is outstanding
+    if (m_wheel.empty()) {
+        m_wheelTimer->stop();
     }
 }
 
-void ClientConnection::slotError(QAbstractSocket::SocketError error) {
-    Q_UNUSED(error)
-    emit signalConnectionFailed(m_socket->errorString());
+int ClientConnection::timeoutFor(uint8_t command) const {
+    switch (command) {
+    case Protocol::ADD_CHARACTER:
+    case Protocol::ADD_CHARACTERS:
+    case Protocol::UPDATE_CHARACTER:
+    case Protocol::REMOVE_CHARACTER:
+        return m_writeTimeoutMs;
+    default:
+        return m_readTimeoutMs;
+    }
+}
+
+void ClientConnection::cancelRequest(int requestId) {
+    if (requestId == 0) {
+        return;
+    }
+    // Hedged copies may sit on any link, so may the rest of a stream
+    for (ServerLink* link : m_links) {
+        link->cancel(requestId);
+    }
+    m_requests.erase(requestId);
+    m_wheel.cancel(deadline_key(requestId));
+    m_wheel.cancel(hedge_key(requestId));
+    streamEnded(requestId);
+}
+
+int ClientConnection::getAllCharacters(uint8_t fields, uint16_t bioPreviewLength) {
+    m_lastCommand = Protocol::GET_ALL;
+    ServerLink* link = readLink();
+    if (!link) {
+        emit signalOperationCompleted(false, "Not connected to server");
+        return 0;
+    }
+
+    ServerLink::Request request{Protocol::GET_ALL};
+    request.fields = fields;
+    request.bioPreviewLength = bioPreviewLength;
+    const int ticket = track(link, request);
+    link->getAllCharacters(fields, bioPreviewLength, ticket);
+    return ticket;
+}
+
+int ClientConnection::streamAllCharacters(uint8_t fields, uint16_t bioPreviewLength) {
+    ServerLink* link = readLink();
+    if (!link) {
+        return 0;
+    }
+
+    m_lastCommand = Protocol::GET_ALL;
+    ServerLink::Request request{Protocol::GET_ALL};
+    // Replaced by the request ID
+    request.streamId = -1;
+    request.fields = fields;
+    request.bioPreviewLength = bioPreviewLength;
+    const int streamId = track(link, request);
+    link->streamAllCharacters(streamId, fields, bioPreviewLength);
+    return streamId;
+}
+
+int ClientConnection::streamQuery(const CharacterQuery& query, uint8_t fields, uint16_t bioPreviewLength) {
+    // Any server answering QUERY beats filtering the whole roster here
+    ServerLink* link = readLink(Protocol::FEATURE_QUERY);
+    if (!link) {
+        return 0;
+    }
+
+    m_lastCommand = Protocol::QUERY;
+    ServerLink::Request request{Protocol::QUERY};
+    // Replaced by the request ID
+    request.streamId = -1;
+    request.fields = fields;
+    request.bioPreviewLength = bioPreviewLength;
+    request.query = query;
+    const int streamId = track(link, request);
+    link->streamQuery(streamId, query, fields, bioPreviewLength);
+    return streamId;
+}
+
+int ClientConnection::getCharacter(int id) {
+    m_lastCommand = Protocol::GET_ONE;
+    ServerLink* link = readLink();
+    if (!link) {
+        emit signalOperationCompleted(false, "Not connected to server");
+        return 0;
+    }
+
+    const int ticket = track(link, {Protocol::GET_ONE, id});
+    link->getCharacter(id, false, ticket);
+    return ticket;
+}
+
+int ClientConnection::prefetchCharacter(int id) {
+    m_lastCommand = Protocol::GET_ONE;
+    ServerLink* link = readLink();
+    if (!link) {
+        emit signalPrefetchFailed(id);
+        return 0;
+    }
+
+    const int ticket = track(link, {Protocol::GET_ONE, id, true});
+    link->getCharacter(id, true, ticket);
+    return ticket;
+}
+
+int ClientConnection::getStats(uint8_t surnameLimit) {
+    m_lastCommand = Protocol::STATS;
+    ServerLink* link = readLink(Protocol::FEATURE_STATS);
+    if (!link) {
+        emit signalStatsFailed(isConnected() ? "Server does not provide statistics" : "Not connected to server");
+        return 0;
+    }
+
+    ServerLink::Request request{Protocol::STATS};
+    request.surnameLimit = surnameLimit;
+    const int ticket = track(link, request);
+    link->getStats(surnameLimit, ticket);
+    return ticket;
+}
+
+void ClientConnection::subscribeToChanges() {
+    m_lastCommand = Protocol::SUBSCRIBE;
+    ServerLink* link = canWrite() ? m_primary : readLink();
+    if (!link) {
+        emit signalOperationCompleted(false, "Not connected to server");
+        return;
+    }
+    m_subscriptionLink = link;
+    link->subscribeToChanges(track(link, {Protocol::SUBSCRIBE}));
+}
+
+int ClientConnection::addCharacter(const CharacterData& character) {
+    m_lastCommand = Protocol::ADD_CHARACTER;
+    if (!canWrite()) {
+        emit signalOperationCompleted(false, "Primary server unavailable");
+        return 0;
+    }
+
+    const int ticket = track(m_primary, {Protocol::ADD_CHARACTER});
+    m_primary->addCharacter(character, ticket);
+    return ticket;
+}
+
+void ClientConnection::addCharacters(const std::vector<CharacterData>& characters) {
+    if (characters.empty()) {
+        return;
+    }
+
+    m_lastCommand = Protocol::ADD_CHARACTERS;
+    if (!canWrite()) {
+        emit signalBatchCompleted(0, static_cast<quint32>(characters.size()));
+        return;
+    }
+
+    if (m_primary->features() & Protocol::FEATURE_BATCH_ADD) {
+        ServerLink::Request request{Protocol::ADD_CHARACTERS};
+        request.batchSize = static_cast<uint32_t>(characters.size());
+        m_primary->addCharacters(characters, track(m_primary, request));
+        return;
+    }
+
+    // One acknowledgement per record, each with its own deadline
+    ServerLink::Request request{Protocol::ADD_CHARACTER};
+    request.batchSize = 1;
+    for (const auto& character : characters) {
+        m_primary->addCharacter(character, track(m_primary, request), 1);
+    }
+}
+
+void ClientConnection::slotUpdateCharacter(const CharacterData& character) {
+    m_lastCommand = Protocol::UPDATE_CHARACTER;
+    if (!canWrite()) {
+        emit signalOperationCompleted(false, "Primary server unavailable");
+        return;
+    }
+    m_primary->updateCharacter(character, track(m_primary, {Protocol::UPDATE_CHARACTER, character.id}));
+}
+
+void ClientConnection::slotRemoveCharacter(int id) {
+    m_lastCommand = Protocol::REMOVE_CHARACTER;
+    if (!canWrite()) {
+        emit signalOperationCompleted(false, "Primary server unavailable");
+        return;
+    }
+    m_primary->removeCharacter(id, track(m_primary, {Protocol::REMOVE_CHARACTER, id}));
+}
+
+void ClientConnection::setMaxFrameSize(uint32_t bytes) {
+    m_maxFrameSize = bytes;
+    for (ServerLink* link : m_links) {
+        link->setMaxFrameSize(bytes);
+    }
+}
+
+void ClientConnection::setReadBufferSize(qint64 bytes) {
+    m_readBufferSize = bytes;
+    for (ServerLink* link : m_links) {
+        link->setReadBufferSize(bytes);
+    }
+}
+
+void ClientConnection::pauseReading() {
+    m_readPaused = true;
+    for (ServerLink* link : m_links) {
+        link->pauseReading();
+    }
+}
+
+void ClientConnection::resumeReading() {
+    m_readPaused = false;
+    for (ServerLink* link : m_links) {
+        link->resumeReading();
+    }
+}
+
+ClientConnection::BufferStats ClientConnection::bufferStats() const {
+    BufferStats total;
+    for (const ServerLink* link : m_links) {
+        const BufferStats& stats = link->bufferStats();
+        total.bufferHighWater = std::max(total.bufferHighWater, stats.bufferHighWater);
+        total.socketHighWater = std::max(total.socketHighWater, stats.socketHighWater);
+        total.largestFrame = std::max(total.largestFrame, stats.largestFrame);
+        total.bytesReceived += stats.bytesReceived;
+        total.yields += stats.yields;
+    }
+    return total;
+}
+
+void ClientConnection::resetBufferStats() {
+    for (ServerLink* link : m_links) {
+        link->resetBufferStats();
+    }
 }
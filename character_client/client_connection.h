@@ -1,21 +1,35 @@
 #ifndef CLIENT_CONNECTION_H
 #define CLIENT_CONNECTION_H
 
+#include <QElapsedTimer>
 #include <QObject>
-#include <QTcpSocket>
+#include <QString>
+#include <QTimer>
+#include <unordered_map>
 #include <vector>
 #include "protocol.h"
+#include "server_link.h"
+#include "timer_wheel.h"
 
 /**
  * \class ClientConnection
- * \brief Handles TCP communication with the character server
+ * \brief Routes requests to a primary character server and its read replicas
  * \ingroup Network
  *
- * \details Manages all client-side network operations including:
- * - Connection establishment
- * - Request/response handling
- * - Character data serialization
- * - Error recovery
+ * \details Keeps one ServerLink per endpoint and decides where each
+ * request goes:
+ * - Mutations go to the primary
+ * - Reads go to the healthy replica with the lowest smoothed round-trip
+ *   time, or to the primary if no replica is up
+ * - Reads go to the primary for a short while after the client's own
+ *   mutation, so it sees what it wrote
+ * - Reads lost with a server are resent to another one
+ * - Dropped servers are reconnected in the background
+ * - Requests fail after a deadline instead of waiting forever
+ * - Slow single-character reads can be hedged on a second server
+ *
+ * Replicas may lag the primary, the change subscription is therefore kept
+ * on the primary whenever it is up.
  *
  * Uses Qt's signal-slot mechanism for asynchronous operation.
  */
@@ -23,6 +37,28 @@ class ClientConnection : public QObject {
     Q_OBJECT
 
 public:
+    /// \see ServerLink::BufferStats
+    using BufferStats = ServerLink::BufferStats;
+
+    /**
+     * \struct Endpoint
+     * \brief Address, transport and role of one server
+     */
+    struct Endpoint {
+        /**
+         * \brief What a server is used for
+         */
+        enum class Role {
+            Primary,    ///< Takes mutations and reads
+            Replica     ///< Takes reads only
+        };
+
+        QString host;                   ///< Server hostname/IP address, or the socket name for local transports
+        quint16 port = Protocol::PORT;  ///< Server port, TCP only
+        Role role = Role::Primary;      ///< What the server is used for
+        Transport::Kind transport = Transport::Kind::Tcp; ///< How bytes reach the server
+    };
+
     /**
      * \brief Constructs a new ClientConnection
      * \param parent Optional QObject parent
@@ -30,37 +66,307 @@ public:
     explicit ClientConnection(QObject* parent = nullptr);
 
     /**
-     * \brief Destructor - ensures proper socket cleanup
+     * \brief Parses a comma-separated endpoint list
+     * \param list Entries of the forms:
+     * - host, host:port or tcp://host:port for TCP
+     * - local:name or unix:/path for a local socket
+     * - shm:name for shared memory, name being the doorbell socket
+     * \return std::vector<Endpoint> Endpoints, the first one is the primary,
+     * the others are replicas
+     *
+     * \note A missing or invalid port falls back to Protocol::PORT
+     * \see Transport, SharedMemoryTransport
      */
-    ~ClientConnection();
+    static std::vector<Endpoint> parseEndpoints(const QString& list);
 
     /**
-     * \brief Initiates connection to server
+     * \brief Initiates connection to a single server
      * \param host Server hostname/IP address
      *
      * \note Emits signalConnectionEstablished() or signalConnectionFailed()
      */
     void connectToServer(const QString& host);
 
+    /**
+     * \brief Initiates connections to every endpoint
+     * \param endpoints Servers to use, replaces any previous ones
+     *
+     * \note Emits signalConnectionEstablished() once the first server is up.
+     * Without an Endpoint::Role::Primary endpoint, mutations always fail
+     */
+    void connectToServers(const std::vector<Endpoint>& endpoints);
+
     /**
      * \brief Requests all characters from server
+     * \param fields Mask of Protocol::FIELD_* flags to load
+     * \param bioPreviewLength Bio truncation in bytes, 0 for whole bios
+     * \return int Request ID for cancelRequest(), 0 if not connected
      * \see Protocol::GET_ALL
+     *
+     * \note Uses Protocol::GET_ALL_COLUMNAR when negotiated, the answer
+     * then arrives through signalColumnsReceived()
+     * \note The projection is only sent if Protocol::FEATURE_PROJECTION
+     * is negotiated, otherwise full records are returned
      */
-    void getAllCharacters();
+    int getAllCharacters(uint8_t fields = Protocol::FIELD_ALL, uint16_t bioPreviewLength = 0);
+
+    /**
+     * \brief Requests all characters, decoded while they arrive
+     * \param fields Mask of Protocol::FIELD_* flags to load
+     * \param bioPreviewLength Bio truncation in bytes, 0 for whole bios
+     * \return int Stream ID carried by the stream signals, also its
+     * request ID for cancelRequest(), 0 if not connected
+     * \see Protocol::GET_ALL
+     *
+     * \note Records arrive through signalCharactersChunk(), or through
+     * signalColumnsChunk() one row group at a time when
+     * Protocol::FEATURE_COLUMNAR is negotiated, followed by
+     * signalStreamFinished(). Chunks are emitted while the response is
+     * still arriving, so the roster is never held in memory as a whole
+     * when Protocol::FEATURE_LENGTH_FRAMED is negotiated, otherwise only
+     * the raw payload is
+     * \note A stream lost before its first chunk is resent to another
+     * server under the same ID, one lost later fails
+     * \note The read deadline covers the wait for the first chunk.
+     * Afterwards a server that sends nothing for a whole read deadline
+     * is reconnected, which fails the stream
+     */
+    int streamAllCharacters(uint8_t fields = Protocol::FIELD_ALL, uint16_t bioPreviewLength = 0);
+
+    /**
+     * \brief Requests the characters matching a query, decoded while they arrive
+     * \param query Predicate evaluated by the server
+     * \param fields Mask of Protocol::FIELD_* flags to load
+     * \param bioPreviewLength Bio truncation in bytes, 0 for whole bios
+     * \return int Stream ID carried by the stream signals, also its
+     * request ID for cancelRequest(), 0 if no ready server offers
+     * Protocol::FEATURE_QUERY
+     * \see Protocol::QUERY
+     *
+     * \note Answered like streamAllCharacters(), always row by row
+     * \note Resent on failover only to a server offering the feature,
+     * the stream fails if there is none
+     */
+    int streamQuery(const CharacterQuery& query, uint8_t fields = Protocol::FIELD_ALL,
+                    uint16_t bioPreviewLength = 0);
 
     /**
      * \brief Requests single character by ID
      * \param id Character ID to retrieve
+     * \return int Request ID for cancelRequest(), 0 if not connected
+     * \see Protocol::GET_ONE
+     * \see setHedgedReads()
+     */
+    int getCharacter(int id);
+
+    /**
+     * \brief Requests single character in the background
+     * \param id Character ID to retrieve
+     * \return int Request ID for cancelRequest(), 0 if not connected
      * \see Protocol::GET_ONE
+     * \see setHedgedReads()
+     *
+     * \note Answers with signalCharacterPrefetched() or
+     * signalPrefetchFailed(), never with an error message
+     */
+    int prefetchCharacter(int id);
+
+    /**
+     * \brief Requests roster aggregates
+     * \param surnameLimit Most frequent surnames to include
+     * \return int Request ID for cancelRequest(), 0 if not sent
+     * \see Protocol::STATS
+     *
+     * \note Answers with signalStatsReceived() or signalStatsFailed(),
+     * never with an error message
+     * \note Sent to a server offering Protocol::FEATURE_STATS, also on
+     * failover
      */
-    void getCharacter(int id);
+    int getStats(uint8_t surnameLimit = CharacterStats::DEFAULT_SURNAME_LIMIT);
 
     /**
      * \brief Adds new character to server
      * \param character Character data to add
+     * \return int Request ID for cancelRequest(), 0 if the primary is down
      * \see Protocol::ADD_CHARACTER
      */
-    void addCharacter(const CharacterData& character);
+    int addCharacter(const CharacterData& character);
+
+    /**
+     * \brief Subscribes to server-pushed change notifications
+     * \see Protocol::SUBSCRIBE
+     *
+     * \note Emits signalSubscriptionChanged() once the server answers.
+     * Subscribes on the primary if it is up, on a replica otherwise
+     */
+    void subscribeToChanges();
+
+    /**
+     * \brief Adds several characters to server
+     * \param characters Characters to add
+     * \see Protocol::ADD_CHARACTERS
+     *
+     * \note Sent as one request when Protocol::FEATURE_BATCH_ADD is
+     * negotiated, as one ADD_CHARACTER per record otherwise. Either way
+     * the outcome is reported through signalBatchCompleted(), never through
+     * signalOperationCompleted()
+     */
+    void addCharacters(const std::vector<CharacterData>& characters);
+
+    /**
+     * \brief Gives up on a request
+     * \param requestId ID returned when the request was made
+     *
+     * \note No signal is emitted for the request afterwards, a roster
+     * stream stops mid-way. A mutation the server already received is
+     * still applied, only its answer is dropped
+     */
+    void cancelRequest(int requestId);
+
+    /**
+     * \brief Sets how long reads wait for their answer
+     * \param ms Deadline in milliseconds
+     *
+     * \note Expired requests fail with "Request timed out". A server that
+     * sent nothing for a whole deadline is reconnected and the reads it
+     * held are resent elsewhere
+     */
+    void setReadTimeout(int ms) { m_readTimeoutMs = ms; }
+
+    /**
+     * \brief Returns how long reads wait for their answer
+     * \return int Deadline in milliseconds
+     */
+    int readTimeout() const { return m_readTimeoutMs; }
+
+    /**
+     * \brief Sets how long mutations wait for their answer
+     * \param ms Deadline in milliseconds
+     * \see setReadTimeout()
+     */
+    void setWriteTimeout(int ms) { m_writeTimeoutMs = ms; }
+
+    /**
+     * \brief Returns how long mutations wait for their answer
+     * \return int Deadline in milliseconds
+     */
+    int writeTimeout() const { return m_writeTimeoutMs; }
+
+    /**
+     * \brief Enables hedging of single-character reads
+     * \param enabled True to hedge
+     *
+     * \note A GET_ONE not answered within hedgeDelayMs() is sent again to
+     * another ready server, the first answer wins and the other is
+     * dropped. Needs at least two servers
+     */
+    void setHedgedReads(bool enabled) { m_hedgedReads = enabled; }
+
+    /**
+     * \brief Returns whether single-character reads are hedged
+     * \return bool True if hedging is enabled
+     */
+    bool hedgedReads() const { return m_hedgedReads; }
+
+    /**
+     * \brief Returns the delay before a read is hedged
+     * \return int 95th percentile of recent GET_ONE latencies in
+     * milliseconds, -1 until enough have been measured
+     */
+    int hedgeDelayMs() const;
+
+    /**
+     * \brief Returns the number of hedged copies sent
+     * \return quint64 Count since construction
+     */
+    quint64 hedgesSent() const { return m_hedgesSent; }
+
+    /**
+     * \brief Returns whether any server is connected
+     * \return bool True if reads can be sent
+     */
+    bool isConnected() const;
+
+    /**
+     * \brief Returns whether the primary is connected
+     * \return bool True if mutations can be sent
+     */
+    bool canWrite() const { return m_primary && m_primary->isReady(); }
+
+    /**
+     * \brief Limits the size of messages held in the receive buffer
+     * \param bytes Largest accepted message, length prefix excluded
+     *
+     * \note A larger message drops the connection with signalConnectionFailed().
+     * Streamed rosters are not held whole, the limit applies to each of
+     * their records or row groups instead
+     */
+    void setMaxFrameSize(uint32_t bytes);
+
+    /**
+     * \brief Returns the largest accepted message size
+     * \return uint32_t Size in bytes
+     */
+    uint32_t maxFrameSize() const { return m_maxFrameSize; }
+
+    /**
+     * \brief Limits the bytes each socket reads ahead of the client
+     * \param bytes Socket read buffer size, 0 for unlimited
+     *
+     * \note Once full, the socket stops reading and TCP flow control
+     * slows the server down
+     */
+    void setReadBufferSize(qint64 bytes);
+
+    /**
+     * \brief Stops processing received data until resumeReading()
+     *
+     * \note For consumers that fall behind, received data then backs up
+     * into the socket read buffers and from there into TCP
+     */
+    void pauseReading();
+
+    /**
+     * \brief Resumes processing received data
+     */
+    void resumeReading();
+
+    /**
+     * \brief Returns whether processing received data is paused
+     * \return bool True if paused
+     */
+    bool isReadingPaused() const { return m_readPaused; }
+
+    /**
+     * \brief Returns receive-side memory counters of all servers
+     * \return BufferStats Byte and yield counts summed, high-water marks
+     * of the busiest server
+     */
+    BufferStats bufferStats() const;
+
+    /**
+     * \brief Resets receive-side memory counters
+     */
+    void resetBufferStats();
+
+    /**
+     * \brief Returns whether change notifications are active
+     * \return bool True if the server accepted the subscription
+     */
+    bool isSubscribed() const { return m_subscriptionLink && m_subscriptionLink->isSubscribed(); }
+
+    /**
+     * \brief Returns protocol features negotiated with the server reads go to
+     * \return uint32_t Mask of Protocol::FEATURE_* flags
+     */
+    uint32_t features() const;
+
+    /**
+     * \brief Checks whether any ready server offers features
+     * \param requiredFeatures Mask of Protocol::FEATURE_* flags
+     * \return bool True if a read needing them has somewhere to go
+     */
+    bool supports(uint32_t requiredFeatures) const { return readLink(requiredFeatures) != nullptr; }
 
     /**
      * \brief Returns last command sent to server
@@ -71,12 +377,19 @@ public:
 signals:
     /**
      * \brief Emitted when connection is established
+     *
+     * \note Emitted after feature negotiation, so requests sent from
+     * connected slots already use the negotiated encoding. Emitted again
+     * whenever the change subscription should be renewed: after the server
+     * holding it dropped, and when the primary comes back
      */
     void signalConnectionEstablished();
 
     /**
      * \brief Emitted when connection fails
      * \param error Error description
+     *
+     * \note Reported once per primary outage, replicas fail silently
      */
     void signalConnectionFailed(const QString& error);
 
@@ -86,12 +399,96 @@ signals:
      */
     void signalCharactersReceived(const std::vector<CharacterData>& characters);
 
+    /**
+     * \brief Emitted when the roster is received in columnar form
+     * \param columns Roster as struct-of-arrays
+     * \see Protocol::GET_ALL_COLUMNAR
+     */
+    void signalColumnsReceived(const CharacterColumns& columns);
+
+    /**
+     * \brief Emitted for each run of records decoded from a roster stream
+     * \param streamId Stream ID returned by streamAllCharacters() or streamQuery()
+     * \param characters Records decoded since the previous chunk
+     */
+    void signalCharactersChunk(int streamId, const std::vector<CharacterData>& characters);
+
+    /**
+     * \brief Emitted for each row group decoded from a columnar roster stream
+     * \param streamId Stream ID returned by streamAllCharacters() or streamQuery()
+     * \param columns Rows of the group
+     */
+    void signalColumnsChunk(int streamId, const CharacterColumns& columns);
+
+    /**
+     * \brief Emitted when a roster stream ends
+     * \param streamId Stream ID returned by streamAllCharacters() or streamQuery()
+     * \param success True if every record was received
+     * \param message Error description on failure
+     */
+    void signalStreamFinished(int streamId, bool success, const QString& message);
+
     /**
      * \brief Emitted when single character is received
      * \param character Character data
      */
     void signalCharacterReceived(const CharacterData& character);
 
+    /**
+     * \brief Emitted when a background request for a character is answered
+     * \param character Character data
+     * \see prefetchCharacter()
+     */
+    void signalCharacterPrefetched(const CharacterData& character);
+
+    /**
+     * \brief Emitted when a background request for a character fails
+     * \param id Character ID that was requested
+     * \see prefetchCharacter()
+     */
+    void signalPrefetchFailed(int id);
+
+    /**
+     * \brief Emitted when roster aggregates are received
+     * \param stats Aggregates computed by the server
+     * \see getStats()
+     */
+    void signalStatsReceived(const CharacterStats& stats);
+
+    /**
+     * \brief Emitted when roster aggregates cannot be had
+     * \param message Error description
+     * \see getStats()
+     */
+    void signalStatsFailed(const QString& message);
+
+    /**
+     * \brief Emitted when the server acknowledges records sent by addCharacters()
+     * \param added Records the server stored
+     * \param rejected Records the server refused
+     */
+    void signalBatchCompleted(quint32 added, quint32 rejected);
+
+    /**
+     * \brief Emitted when the server accepts or rejects a subscription
+     * \param active True if change notifications will be pushed
+     */
+    void signalSubscriptionChanged(bool active);
+
+    /**
+     * \brief Emitted when the server pushes added or updated characters
+     * \param characters Changed character records
+     * \see Protocol::NOTIFY_CHANGED
+     */
+    void signalCharactersChanged(const std::vector<CharacterData>& characters);
+
+    /**
+     * \brief Emitted when the server pushes removed character IDs
+     * \param ids IDs of removed characters
+     * \see Protocol::NOTIFY_REMOVED
+     */
+    void signalCharactersRemoved(const std::vector<int32_t>& ids);
+
     /**
      * \brief Emitted when operation completes
      * \param success True if operation succeeded
@@ -116,58 +513,164 @@ public slots:
 
 private slots:
     /**
-     * \brief Handles successful connection
+     * \brief Expires due deadlines and hedges
      */
-    void slotConnected();
+    void slotWheelTick();
 
+private:
     /**
-     * \brief Handles server disconnection
+     * \struct TrackedRequest
+     * \brief Request with a deadline, not answered yet
      */
-    void slotDisconnected();
+    struct TrackedRequest {
+        ServerLink::Request request;        ///< What was asked, for failing or resending it
+        ServerLink* link = nullptr;         ///< Link holding the original
+        ServerLink* hedgeLink = nullptr;    ///< Link holding the hedged copy, if any
+        qint64 sentAtMs = 0;                ///< When the original was sent
+        qint64 hedgeSentAtMs = 0;           ///< When the hedged copy was sent
+    };
 
     /**
-     * \brief Processes incoming data from server
+     * \brief Starts tracking a request about to be sent
+     * \param link Link the request goes to
+     * \param request Description of the request, its ticket is assigned here
+     * \return int Request ID, pass it to the link as ticket
      */
-    void slotReadyRead();
+    int track(ServerLink* link, ServerLink::Request request);
 
     /**
-     * \brief Handles socket errors
-     * \param error Error code
+     * \brief Stops tracking an answered request
+     * \param link Link that answered
+     * \param ticket Request ID
      */
-    void slotError(QAbstractSocket::SocketError error);
+    void linkAnswered(ServerLink* link, int ticket);
+
+    /**
+     * \brief Stops tracking a request and reports its failure
+     * \param ticket Request ID
+     * \param message Error description
+     * \return bool True if the failure is left for signalOperationCompleted()
+     *
+     * \note Streams, batches and prefetches are failed through their own signals
+     */
+    bool failRequest(int ticket, const QString& message);
 
-private:
     /**
-     * \brief Sends request to server
+     * \brief Fails a request whose deadline passed
+     * \param ticket Request ID
+     */
+    void expireRequest(int ticket);
+
+    /**
+     * \brief Checks a stream under way for a stalled server
+     * \param streamId Stream ID
+     */
+    void expireStream(int streamId);
+
+    /**
+     * \brief Stops timing a stream that finished or was cancelled
+     * \param streamId Stream ID
+     */
+    void streamEnded(int streamId);
+
+    /**
+     * \brief Sends a hedged copy of a slow read
+     * \param ticket Request ID
+     */
+    void hedgeRequest(int ticket);
+
+    /**
+     * \brief Schedules a timer on the wheel
+     * \param key Timer key
+     * \param delayMs Time until expiry
+     */
+    void arm(uint64_t key, qint64 delayMs);
+
+    /**
+     * \brief Returns the deadline of a command
      * \param command Protocol command byte
-     * \param data Optional request payload
+     * \return int Deadline in milliseconds
+     */
+    int timeoutFor(uint8_t command) const;
+
+    /**
+     * \brief Creates a link and forwards its signals
+     * \param endpoint Server to connect to
+     * \return ServerLink* Link owned by this object, not opened yet
      */
-    void sendRequest(uint8_t command, const std::vector<uint8_t>& data = {});
+    ServerLink* addLink(const Endpoint& endpoint);
 
     /**
-     * \brief Processes server response
-     * \param data Received binary data
+     * \brief Closes and deletes every link
      */
-    void processResponse(const std::vector<uint8_t>& data);
+    void clearLinks();
 
     /**
-     * \brief Serializes ID for network transmission
-     * \param id ID to serialize
-     * \return std::vector<uint8_t> 4-byte big-endian representation
+     * \brief Picks the server for the next read
+     * \param requiredFeatures Protocol::FEATURE_* flags the server must offer
+     * \param exclude Link not to pick, for hedged copies
+     * \return ServerLink* Ready replica with the lowest round-trip time,
+     * the primary if no replica is ready, null if nothing is
+     *
+     * \note Within READ_YOUR_WRITES_MS of a mutation the primary is
+     * returned while it is up, null if it is excluded
      */
-    std::vector<uint8_t> serializeId(int id);
+    ServerLink* readLink(uint32_t requiredFeatures = 0, const ServerLink* exclude = nullptr) const;
 
     /**
-     * \brief Finds message boundary in buffer
-     * \param pos [out] Position of delimiter if found
-     * \return bool True if delimiter found
+     * \brief Handles a link that finished negotiation
+     * \param link Link that became ready
      */
-    bool findMessageBoundary(size_t& pos);
+    void linkReady(ServerLink* link);
+
+    /**
+     * \brief Handles a failed connection or connection attempt
+     * \param link Link that failed
+     * \param error Error description
+     */
+    void linkFailed(ServerLink* link, const QString& error);
+
+    /**
+     * \brief Resends or fails the requests lost with a link
+     * \param link Link that dropped
+     * \param lost Requests it never answered, oldest first
+     */
+    void linkDisconnected(ServerLink* link, const std::vector<ServerLink::Request>& lost);
+
+    /// Reads stay on the primary this long after a mutation, replicas may lag behind
+    static constexpr qint64 READ_YOUR_WRITES_MS = 3'000;
+    /// Round-trip samples older than this are not trusted, the replica is probed instead
+    static constexpr qint64 RTT_STALE_MS = 10'000;
+    /// Timer wheel resolution
+    static constexpr qint64 WHEEL_TICK_MS = 5;
+    /// Timer wheel slots, one revolution covers a few seconds
+    static constexpr size_t WHEEL_SLOTS = 1024;
+    /// GET_ONE latencies kept for the hedge delay
+    static constexpr size_t LATENCY_SAMPLES = 256;
+    /// Latencies needed before reads are hedged
+    static constexpr size_t MIN_LATENCY_SAMPLES = 20;
 
-    QTcpSocket* m_socket;                     ///< TCP socket instance
-    std::vector<uint8_t> m_buffer;            ///< Raw data buffer
-    uint8_t m_expectedResponse = 0;          ///< Expected response code
-    uint8_t m_lastCommand = 0;               ///< Last sent command
+    std::vector<ServerLink*> m_links;           ///< One link per endpoint, owned
+    ServerLink* m_primary = nullptr;            ///< Link mutations go to, null if none
+    ServerLink* m_subscriptionLink = nullptr;   ///< Link whose notifications are forwarded
+    bool m_primaryFailureReported = false;      ///< Primary outage already reported
+    int m_nextRequestId = 1;                    ///< Next request ID, stream IDs included
+    uint8_t m_lastCommand = 0;                  ///< Last sent command
+    qint64 m_lastWriteMs = -1;                  ///< Last mutation sent or acknowledged, -1 if none
+    uint32_t m_maxFrameSize = ServerLink::DEFAULT_MAX_FRAME_SIZE; ///< Applied to every link
+    qint64 m_readBufferSize = ServerLink::DEFAULT_READ_BUFFER_SIZE; ///< Applied to every link
+    bool m_readPaused = false;                  ///< Received data is left in the sockets
+    std::unordered_map<int, TrackedRequest> m_requests; ///< Requests awaiting an answer by ID
+    std::unordered_map<int, ServerLink*> m_streams; ///< Link of each stream under way, by stream ID
+    TimerWheel m_wheel;                         ///< Deadlines, hedge and stream timers
+    QTimer* m_wheelTimer;                       ///< Drives m_wheel while it holds timers
+    QElapsedTimer m_clock;                      ///< Time base for m_wheel and latencies
+    int m_readTimeoutMs = Protocol::READ_TIMEOUT;   ///< Read deadline
+    int m_writeTimeoutMs = Protocol::WRITE_TIMEOUT; ///< Mutation deadline
+    bool m_hedgedReads = false;                 ///< GET_ONE is hedged
+    std::vector<qint64> m_latencies;            ///< Recent GET_ONE latencies, a ring
+    size_t m_nextLatency = 0;                   ///< Ring position of the next sample
+    quint64 m_hedgesSent = 0;                   ///< Hedged copies sent
 };
 
 #endif // CLIENT_CONNECTION_H
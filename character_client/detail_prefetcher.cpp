@@ -0,0 +1,104 @@
+#include "detail_prefetcher.h"
+
+namespace {
+// Full records, bios included, are kept for a few pages of rows
+constexpr int CACHE_CAPACITY = 256;
+}
+
+DetailPrefetcher::DetailPrefetcher(ClientConnection* connection, CharacterTableModel* model, QObject* parent)
+    : QObject(parent),
+      m_connection(connection),
+      m_model(model),
+      m_cache(CACHE_CAPACITY)
+{
+    connect(
+                m_connection, &ClientConnection::signalCharacterPrefetched,
+                this, &DetailPrefetcher::slotCharacterPrefetched
+                );
+    connect(
+                m_connection, &ClientConnection::signalPrefetchFailed,
+                this, &DetailPrefetcher::slotPrefetchFailed
+                );
+}
+
+bool DetailPrefetcher::cached(int id, CharacterData& character) const {
+    const CharacterData* found = m_cache.object(id);
+    if (!found) {
+        return false;
+    }
+    character = *found;
+    return true;
+}
+
+void DetailPrefetcher::invalidate(int id) {
+    m_cache.remove(id);
+}
+
+void DetailPrefetcher::clear() {
+    m_cache.clear();
+    m_queue.clear();
+    // Answers still on the wire are cached on arrival but no longer hold budget
+    m_inFlight.clear();
+}
+
+void DetailPrefetcher::slotFocusRow(int row) {
+    if (row < 0 || row >= m_model->rowCount()) {
+        return;
+    }
+
+    // Whatever was queued for the previous focus is no longer wanted
+    m_queue.clear();
+
+    // Focused row first, then neighbours by distance
+    QSet<int> window;
+    for (int distance = 0; distance <= m_radius; ++distance) {
+        for (int candidate : {row - distance, row + distance}) {
+            if (candidate < 0 || candidate >= m_model->rowCount()) {
+                continue;
+            }
+            int id = m_model->idAt(candidate);
+            window.insert(id);
+            if (m_cache.contains(id) || m_inFlight.contains(id) || m_queue.contains(id)) {
+                continue;
+            }
+            m_queue.append(id);
+        }
+    }
+
+    // Outstanding requests for rows left behind only hold budget
+    for (auto it = m_inFlight.begin(); it != m_inFlight.end();) {
+        if (window.contains(it.key())) {
+            ++it;
+            continue;
+        }
+        const int id = it.key();
+        m_connection->cancelRequest(it.value());
+        it = m_inFlight.erase(it);
+        emit signalPrefetchCancelled(id);
+    }
+
+    pump();
+}
+
+void DetailPrefetcher::slotCharacterPrefetched(const CharacterData& character) {
+    m_inFlight.remove(character.id);
+    m_cache.insert(character.id, new CharacterData(character));
+    emit signalDetailsReady(character);
+    pump();
+}
+
+void DetailPrefetcher::slotPrefetchFailed(int id) {
+    m_inFlight.remove(id);
+    pump();
+}
+
+void DetailPrefetcher::pump() {
+    while (static_cast<int>(m_inFlight.size()) < m_budget && !m_queue.isEmpty()) {
+        int id = m_queue.takeFirst();
+        const int requestId = m_connection->prefetchCharacter(id);
+        // Failed at once, signalPrefetchFailed() has been handled already
+        if (requestId != 0) {
+            m_inFlight.insert(id, requestId);
+        }
+    }
+}
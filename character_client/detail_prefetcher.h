@@ -0,0 +1,137 @@
+/**
+ * \file detail_prefetcher.h
+ * \brief Background loading of character details around the focused row
+ */
+
+#ifndef DETAIL_PREFETCHER_H
+#define DETAIL_PREFETCHER_H
+
+#include <QCache>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include "character_table_model.h"
+#include "client_connection.h"
+
+/**
+ * \class DetailPrefetcher
+ * \brief Requests full character records before the user asks for them
+ *
+ * \details Follows the row under the selection or the mouse and keeps the
+ * records of that row and its neighbours in a small cache. At most
+ * budget() requests are on the wire at once. Requests still queued when
+ * the focus moves elsewhere are dropped, requests already sent for rows
+ * that left the window are cancelled.
+ */
+class DetailPrefetcher : public QObject {
+    Q_OBJECT
+
+public:
+    /**
+     * \brief Constructs a prefetcher
+     * \param connection Connection used for background requests
+     * \param model Model mapping rows to character IDs
+     * \param parent Optional QObject parent
+     */
+    DetailPrefetcher(ClientConnection* connection, CharacterTableModel* model, QObject* parent = nullptr);
+
+    /**
+     * \brief Sets how many rows above and below the focus are prefetched
+     * \param radius Neighbour count on each side
+     */
+    void setRadius(int radius) { m_radius = radius; }
+
+    /**
+     * \brief Sets the maximum number of outstanding requests
+     * \param budget Request count
+     */
+    void setBudget(int budget) { m_budget = budget; }
+
+    /**
+     * \brief Returns the maximum number of outstanding requests
+     * \return int Request count
+     */
+    int budget() const { return m_budget; }
+
+    /**
+     * \brief Looks up a prefetched character
+     * \param id Character ID
+     * \param character [out] Cached character data
+     * \return bool True if the character was cached
+     */
+    bool cached(int id, CharacterData& character) const;
+
+    /**
+     * \brief Returns whether a request for a character is on the wire
+     * \param id Character ID
+     * \return bool True if a request is outstanding
+     */
+    bool isInFlight(int id) const { return m_inFlight.contains(id); }
+
+    /**
+     * \brief Drops a character from the cache
+     * \param id Character ID
+     */
+    void invalidate(int id);
+
+    /**
+     * \brief Drops every cached character and queued request
+     *
+     * \note Also forgets outstanding requests, call it on refresh and
+     * reconnect so lost answers do not hold the budget forever
+     */
+    void clear();
+
+signals:
+    /**
+     * \brief Emitted when a prefetched character arrives
+     * \param character Character data
+     */
+    void signalDetailsReady(const CharacterData& character);
+
+    /**
+     * \brief Emitted when a request is given up as its row left the window
+     * \param id Character ID that was requested
+     *
+     * \note Nothing else arrives for the id, whoever waits on it has to
+     * fetch it on its own
+     */
+    void signalPrefetchCancelled(int id);
+
+public slots:
+    /**
+     * \brief Moves the prefetch window to a row
+     * \param row Focused row, ignored if out of range
+     */
+    void slotFocusRow(int row);
+
+private slots:
+    /**
+     * \brief Stores a prefetched character
+     * \param character Character data
+     */
+    void slotCharacterPrefetched(const CharacterData& character);
+
+    /**
+     * \brief Releases the budget held by a failed request
+     * \param id Character ID
+     */
+    void slotPrefetchFailed(int id);
+
+private:
+    /**
+     * \brief Sends queued requests while the budget allows
+     */
+    void pump();
+
+    ClientConnection* m_connection;          ///< Connection for background requests
+    CharacterTableModel* m_model;            ///< Row to ID mapping
+    QList<int> m_queue;                      ///< IDs waiting for budget, nearest first
+    QHash<int, int> m_inFlight;              ///< Request IDs by character ID, not answered yet
+    QCache<int, CharacterData> m_cache;      ///< Prefetched characters
+    int m_radius = 2;                        ///< Neighbours on each side of the focus
+    int m_budget = 4;                        ///< Maximum outstanding requests
+};
+
+#endif // DETAIL_PREFETCHER_H
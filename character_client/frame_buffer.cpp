@@ -0,0 +1,90 @@
+#include "frame_buffer.h"
+#include "protocol.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+FrameBuffer::FrameBuffer(uint32_t maxFrameSize)
+    : m_maxFrameSize(maxFrameSize)
+{
+}
+
+void FrameBuffer::append(const char* data, size_t size) {
+    // Compacted only once the consumed part dominates, not per message
+    if (m_offset > 0 && m_offset >= m_data.size() / 2) {
+        m_data.erase(m_data.begin(), m_data.begin() + m_offset);
+        m_searchFrom -= m_offset;
+        m_offset = 0;
+    }
+    m_data.insert(m_data.end(), data, data + size);
+}
+
+bool FrameBuffer::next(std::vector<uint8_t>& message) {
+    const size_t available = m_data.size() - m_offset;
+
+    if (m_framed) {
+        uint32_t length = 0;
+        if (available < sizeof(length)) {
+            return false;
+        }
+        std::memcpy(&length, m_data.data() + m_offset, sizeof(length));
+        // Checked before waiting for the body, which may never fit
+        if (length > m_maxFrameSize) {
+            throw std::length_error("Message of " + std::to_string(length) + " bytes exceeds limit");
+        }
+        if (available - sizeof(length) < length) {
+            return false;
+        }
+        const auto begin = m_data.begin() + m_offset + sizeof(length);
+        message.assign(begin, begin + length);
+        consume(sizeof(length) + length);
+        return true;
+    }
+
+    // A delimiter may straddle the previous search end
+    const size_t from = std::max(m_offset, m_searchFrom > 0 ? m_searchFrom - 1 : 0);
+    auto it = std::search(
+                m_data.begin() + from, m_data.end(),
+                Protocol::MESSAGE_DELIMITER.begin(), Protocol::MESSAGE_DELIMITER.end()
+                );
+    if (it == m_data.end()) {
+        m_searchFrom = m_data.size();
+        if (available > m_maxFrameSize) {
+            throw std::length_error("Undelimited message exceeds limit");
+        }
+        return false;
+    }
+    message.assign(m_data.begin() + m_offset, it);
+    consume(message.size() + Protocol::MESSAGE_DELIMITER_SIZE);
+    return true;
+}
+
+void FrameBuffer::consume(size_t size) {
+    m_offset += size;
+    m_searchFrom = m_offset;
+    if (m_offset == m_data.size()) {
+        m_data.clear();
+        m_offset = 0;
+        m_searchFrom = 0;
+    }
+}
+
+void FrameBuffer::clear() {
+    m_data.clear();
+    m_offset = 0;
+    m_searchFrom = 0;
+    m_framed = false;
+}
+
+void FrameBuffer::write(QIODevice* device, const std::vector<uint8_t>& message, bool framed) {
+    if (framed) {
+        const uint32_t length = static_cast<uint32_t>(message.size());
+        device->write(reinterpret_cast<const char*>(&length), sizeof(length));
+    }
+    device->write(reinterpret_cast<const char*>(message.data()), static_cast<qint64>(message.size()));
+    if (!framed) {
+        device->write(Protocol::MESSAGE_DELIMITER.data(), Protocol::MESSAGE_DELIMITER_SIZE);
+    }
+}
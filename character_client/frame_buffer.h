@@ -0,0 +1,114 @@
+/**
+ * \file frame_buffer.h
+ * \brief Message framing shared by the client and both sides of the proxy
+ */
+
+#ifndef FRAME_BUFFER_H
+#define FRAME_BUFFER_H
+
+#include <QIODevice>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/// Message body, command byte first, shared by the proxy's cache and every receiver
+using SharedMessage = std::shared_ptr<const std::vector<uint8_t>>;
+
+/**
+ * \class FrameBuffer
+ * \brief Splits a byte stream into protocol messages
+ *
+ * \details Messages are delimited by Protocol::MESSAGE_DELIMITER until
+ * Protocol::FEATURE_LENGTH_FRAMED is negotiated, then prefixed with
+ * their uint32_t length. Consumed bytes are dropped in bulk rather
+ * than per message, and a delimiter search never rescans bytes it has
+ * already looked at.
+ */
+class FrameBuffer {
+public:
+    /**
+     * \brief Constructs an empty buffer in delimiter framing
+     * \param maxFrameSize Largest accepted message, length prefix excluded
+     */
+    explicit FrameBuffer(uint32_t maxFrameSize);
+
+    /**
+     * \brief Appends received bytes
+     * \param data Received bytes
+     * \param size Number of bytes
+     */
+    void append(const char* data, size_t size);
+
+    /**
+     * \brief Extracts the next complete message
+     * \param message [out] Message without framing
+     * \return bool True if a complete message was extracted
+     * \throws std::length_error if the message exceeds the frame size limit
+     */
+    bool next(std::vector<uint8_t>& message);
+
+    /**
+     * \brief Returns the bytes not consumed yet, for reading past the framing
+     * \return const uint8_t* First unconsumed byte, size() of them follow
+     */
+    const uint8_t* data() const { return m_data.data() + m_offset; }
+
+    /**
+     * \brief Returns the number of bytes not consumed yet
+     * \return size_t Byte count
+     */
+    size_t size() const { return m_data.size() - m_offset; }
+
+    /**
+     * \brief Marks bytes read through data() as consumed
+     * \param size Number of bytes, at most size()
+     */
+    void consume(size_t size);
+
+    /**
+     * \brief Switches between delimiter and length framing
+     * \param framed True for length framing
+     */
+    void setFramed(bool framed) { m_framed = framed; }
+
+    /**
+     * \brief Returns the current framing
+     * \return bool True for length framing
+     */
+    bool framed() const { return m_framed; }
+
+    /**
+     * \brief Changes the largest accepted message
+     * \param maxFrameSize Largest accepted message, length prefix excluded
+     */
+    void setMaxFrameSize(uint32_t maxFrameSize) { m_maxFrameSize = maxFrameSize; }
+
+    /**
+     * \brief Returns the largest accepted message
+     * \return uint32_t Limit in bytes, length prefix excluded
+     */
+    uint32_t maxFrameSize() const { return m_maxFrameSize; }
+
+    /**
+     * \brief Drops buffered bytes and returns to delimiter framing
+     */
+    void clear();
+
+    /**
+     * \brief Writes one message with the given framing
+     * \param device Device to write to
+     * \param message Message body, command byte first
+     * \param framed True for length framing
+     */
+    static void write(QIODevice* device, const std::vector<uint8_t>& message, bool framed);
+
+private:
+    std::vector<uint8_t> m_data;        ///< Received bytes, consumed ones first
+    size_t m_offset = 0;                ///< First unconsumed byte
+    size_t m_searchFrom = 0;            ///< First byte a delimiter search has not checked
+    bool m_framed = false;              ///< Length framing is negotiated
+    uint32_t m_maxFrameSize;            ///< Largest accepted message
+};
+
+#endif // FRAME_BUFFER_H
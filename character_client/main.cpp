@@ -1,11 +1,15 @@
 #include "main_window.h"
 
 #include <QApplication>
+#include <QStringList>
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
-    MainWindow w;
+    // Optional endpoint list, e.g. 127.0.0.1:12345,127.0.0.1:12346 or
+    // shm:character_server on the server's host
+    const QStringList args = a.arguments();
+    MainWindow w(args.size() > 1 ? args.at(1) : QString("10.0.2.5"));
     w.show();
     return a.exec();
 }
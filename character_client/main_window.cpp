@@ -1,16 +1,37 @@
 #include "main_window.h"
 #include "ui_main_window.h"
+#include <QFileDialog>
 #include <QMessageBox>
 #include <QHeaderView>
 
 #include "character_info_dialog.h"
+#include "character_validation.h"
 #include "add_character_dialog.h"
 
-MainWindow::MainWindow(QWidget* parent)
+namespace {
+// Bytes of bio shown with the roster, the rest comes with GET_ONE
+constexpr uint16_t BIO_PREVIEW_LENGTH = 80;
+
+// One byte past the preview tells a cut bio from one exactly that long
+uint16_t requested_bio_length(uint16_t bioPreviewLength) {
+    return bioPreviewLength == 0 ? 0 : static_cast<uint16_t>(bioPreviewLength + 1);
+}
+// Bursts of changes are summarized once
+constexpr int STATS_DELAY_MS = 1000;
+// Surnames listed in the statistics tooltip
+constexpr uint8_t STATS_SURNAMES = 5;
+}
+
+MainWindow::MainWindow(const QString& endpoints, QWidget* parent)
     : QMainWindow(parent),
       ui(new Ui::MainWindow),
       m_connection(new ClientConnection(this)),
-      m_model(new QStandardItemModel(this))
+      m_model(new CharacterTableModel(this)),
+      m_prefetcher(new DetailPrefetcher(m_connection, m_model, this)),
+      m_importer(new BulkImporter(m_connection, this)),
+      m_exporter(new RosterExporter(m_connection, this)),
+      m_statsLabel(new QLabel(this)),
+      m_statsTimer(new QTimer(this))
 {
     ui->setupUi(this);
     setWindowTitle("Character Database Client");
@@ -18,9 +39,29 @@ MainWindow::MainWindow(QWidget* parent)
     // Setup table
     setupTable();
 
+    // Roster summary, kept apart from transient status messages
+    ui->statusbar->addPermanentWidget(m_statsLabel);
+    m_statsTimer->setSingleShot(true);
+    m_statsTimer->setInterval(STATS_DELAY_MS);
+    connect(m_statsTimer, &QTimer::timeout, this, [this]() { m_connection->getStats(STATS_SURNAMES); });
+
     // Connect UI signals
     connect(ui->showInfoButton, &QPushButton::clicked, this, &MainWindow::slotShowInfoClicked);
     connect(ui->addButton, &QPushButton::clicked, this, &MainWindow::slotAddClicked);
+    connect(ui->importButton, &QPushButton::clicked, this, &MainWindow::slotImportClicked);
+    connect(ui->exportButton, &QPushButton::clicked, this, &MainWindow::slotExportClicked);
+
+    // Filter bar, 0 stands for no bound
+    ui->minAgeSpin->setMaximum(CharacterValidation::MAX_AGE);
+    ui->maxAgeSpin->setMaximum(CharacterValidation::MAX_AGE);
+    connect(ui->applyFilterButton, &QPushButton::clicked, this, &MainWindow::slotApplyFilterClicked);
+    connect(ui->clearFilterButton, &QPushButton::clicked, this, &MainWindow::slotClearFilterClicked);
+    for (QLineEdit* edit : {ui->namePrefixEdit, ui->surnamePrefixEdit, ui->bioFilterEdit}) {
+        connect(edit, &QLineEdit::returnPressed, this, &MainWindow::slotApplyFilterClicked);
+    }
+
+    // Detail lookups are short, a replica lagging behind is worth a second try
+    m_connection->setHedgedReads(true);
 
     // Connect network signals
     connect(
@@ -32,20 +73,95 @@ MainWindow::MainWindow(QWidget* parent)
                 this, &MainWindow::slotConnectionFailed
                 );
     connect(
-                m_connection, &ClientConnection::signalCharactersReceived,
-                this, &MainWindow::slotCharactersReceived
+                m_connection, &ClientConnection::signalCharactersChunk,
+                this, &MainWindow::slotCharactersChunk
+                );
+    connect(
+                m_connection, &ClientConnection::signalColumnsChunk,
+                this, &MainWindow::slotColumnsChunk
+                );
+    connect(
+                m_connection, &ClientConnection::signalStreamFinished,
+                this, &MainWindow::slotStreamFinished
                 );
     connect(
                 m_connection, &ClientConnection::signalCharacterReceived,
                 this, &MainWindow::slotCharacterReceived
                 );
+    connect(
+                m_connection, &ClientConnection::signalSubscriptionChanged,
+                this, &MainWindow::slotSubscriptionChanged
+                );
+    connect(
+                m_connection, &ClientConnection::signalCharactersChanged,
+                this, &MainWindow::slotCharactersChanged
+                );
+    connect(
+                m_connection, &ClientConnection::signalCharactersRemoved,
+                this, &MainWindow::slotCharactersRemoved
+                );
     connect(
                 m_connection, &ClientConnection::signalOperationCompleted,
                 this, &MainWindow::slotOperationCompleted
                 );
 
-    // Connect to server, address is hardcoded
-    m_connection->connectToServer("10.0.2.5");
+    // Prefetch details around the selected and hovered rows
+    connect(
+                ui->tableView->selectionModel(), &QItemSelectionModel::currentRowChanged,
+                this, [this](const QModelIndex& current) { m_prefetcher->slotFocusRow(current.row()); }
+                );
+    connect(
+                ui->tableView, &QAbstractItemView::entered,
+                this, [this](const QModelIndex& index) { m_prefetcher->slotFocusRow(index.row()); }
+                );
+    // Expanding a bio cell loads the full record
+    connect(
+                ui->tableView, &QAbstractItemView::doubleClicked,
+                this, &MainWindow::slotCellDoubleClicked
+                );
+    connect(
+                m_prefetcher, &DetailPrefetcher::signalDetailsReady,
+                this, &MainWindow::slotDetailsPrefetched
+                );
+    // The dialog may be waiting on a prefetch the focus moved away from
+    connect(
+                m_prefetcher, &DetailPrefetcher::signalPrefetchCancelled,
+                this, &MainWindow::slotPrefetchFailed
+                );
+    connect(
+                m_connection, &ClientConnection::signalPrefetchFailed,
+                this, &MainWindow::slotPrefetchFailed
+                );
+    connect(
+                m_connection, &ClientConnection::signalStatsReceived,
+                this, &MainWindow::slotStatsReceived
+                );
+    connect(
+                m_connection, &ClientConnection::signalStatsFailed,
+                this, &MainWindow::slotStatsFailed
+                );
+
+    // Bulk import
+    connect(
+                m_importer, &BulkImporter::signalProgress,
+                this, &MainWindow::slotImportProgress
+                );
+    connect(
+                m_importer, &BulkImporter::signalFinished,
+                this, &MainWindow::slotImportFinished
+                );
+
+    // Roster export
+    connect(
+                m_exporter, &RosterExporter::signalProgress,
+                this, &MainWindow::slotExportProgress
+                );
+    connect(
+                m_exporter, &RosterExporter::signalFinished,
+                this, &MainWindow::slotExportFinished
+                );
+
+    m_connection->connectToServers(ClientConnection::parseEndpoints(endpoints));
 }
 
 MainWindow::~MainWindow() {
@@ -53,19 +169,73 @@ MainWindow::~MainWindow() {
 }
 
 void MainWindow::setupTable() {
-    m_model->setColumnCount(5);
-    m_model->setHorizontalHeaderLabels({"ID", "Name", "Surname", "Age", "Bio"});
     ui->tableView->setModel(m_model);
     ui->tableView->setSelectionBehavior(QAbstractItemView::SelectRows);
     ui->tableView->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
     ui->tableView->verticalHeader()->setVisible(false);
+    // Needed for entered(), which drives hover prefetch
+    ui->tableView->setMouseTracking(true);
 }
 
 void MainWindow::refreshCharacters() {
-    m_connection->getAllCharacters();
+    // Rows are merged as they arrive, the old roster stays until replaced
+    m_connection->cancelRequest(m_rosterStreamId);
+    m_model->endRefresh(false);
+    m_rosterStarted = false;
+    m_filterMatched = 0;
+    m_filterLocally = false;
+    m_rosterBioLength = BIO_PREVIEW_LENGTH;
+
+    if (!m_filter.isEmpty()) {
+        // Only matching rows cross the wire
+        m_rosterStreamId = m_connection->streamQuery(m_filter, Protocol::FIELD_ALL,
+                                                     requested_bio_length(BIO_PREVIEW_LENGTH));
+        if (m_rosterStreamId != 0 || !m_connection->isConnected()) {
+            return;
+        }
+        // Server predates QUERY, everything is fetched and filtered here
+        m_filterLocally = true;
+        if (!m_filter.bioSubstring.empty()) {
+            // A preview would hide matches further into the bio
+            m_rosterBioLength = 0;
+        }
+    }
+    m_rosterStreamId = m_connection->streamAllCharacters(Protocol::FIELD_ALL, requested_bio_length(m_rosterBioLength));
+}
+
+std::vector<CharacterData> MainWindow::filterLocally(std::vector<CharacterData> characters) {
+    auto kept = characters.begin();
+    for (auto& character : characters) {
+        if (m_filter.limit != 0 && m_filterMatched >= m_filter.limit) {
+            break;
+        }
+        if (m_filter.matches(character)) {
+            *kept++ = std::move(character);
+            ++m_filterMatched;
+        }
+    }
+    characters.erase(kept, characters.end());
+    return characters;
+}
+
+void MainWindow::scheduleStats() {
+    // Restarted by every change, a burst costs one request
+    m_statsTimer->start();
+}
+
+size_t MainWindow::loadedBioLength() const {
+    return (m_connection->features() & Protocol::FEATURE_PROJECTION) ? m_rosterBioLength : 0;
 }
 
 void MainWindow::slotConnectionEstablished() {
+    m_pendingInfoId = -1;
+    m_prefetcher->clear();
+    // Subscribe before the first snapshot so no change falls in between
+    m_connection->subscribeToChanges();
+}
+
+void MainWindow::slotSubscriptionChanged(bool active) {
+    Q_UNUSED(active)
     refreshCharacters();
 }
 
@@ -73,20 +243,165 @@ void MainWindow::slotConnectionFailed(const QString& error) {
     showError("Connection failed: " + error);
 }
 
-void MainWindow::slotCharactersReceived(const std::vector<CharacterData>& characters) {
-    m_model->removeRows(0, m_model->rowCount());
+void MainWindow::slotCharactersChunk(int streamId, const std::vector<CharacterData>& characters) {
+    if (streamId != m_rosterStreamId) {
+        return;
+    }
+    if (!m_rosterStarted) {
+        m_rosterStarted = true;
+        m_prefetcher->clear();
+        m_model->beginRefresh(loadedBioLength());
+    }
+    m_model->mergeCharacters(m_filterLocally ? filterLocally(characters) : characters);
+}
+
+void MainWindow::slotColumnsChunk(int streamId, const CharacterColumns& columns) {
+    if (streamId != m_rosterStreamId) {
+        return;
+    }
+    if (!m_rosterStarted) {
+        m_rosterStarted = true;
+        m_prefetcher->clear();
+        m_model->beginRefresh(loadedBioLength());
+    }
+    if (m_filterLocally) {
+        std::vector<CharacterData> characters;
+        characters.reserve(columns.size());
+        for (size_t row = 0; row < columns.size(); ++row) {
+            characters.push_back(columns.row(row));
+        }
+        m_model->mergeCharacters(filterLocally(std::move(characters)));
+        return;
+    }
+    m_model->mergeColumns(columns);
+}
+
+void MainWindow::slotStreamFinished(int streamId, bool success, const QString& message) {
+    if (streamId != m_rosterStreamId) {
+        return;
+    }
+    m_rosterStreamId = 0;
+    // Failed over to servers that all predate QUERY
+    if (!success && !m_filter.isEmpty() && !m_filterLocally && m_connection->isConnected()
+            && !m_connection->supports(Protocol::FEATURE_QUERY)) {
+        refreshCharacters();
+        return;
+    }
+    if (success && !m_rosterStarted) {
+        // Empty database, every row goes
+        m_prefetcher->clear();
+        m_model->beginRefresh();
+    }
+    // A failed transfer keeps the rows it did not reach
+    m_model->endRefresh(success);
+    if (success) {
+        scheduleStats();
+    }
+    // Connection loss is reported on its own
+    if (!success && m_connection->isConnected()) {
+        showError(message);
+    }
+}
+
+void MainWindow::slotCharactersChanged(const std::vector<CharacterData>& characters) {
+    // Patched in place, keeps selection and scroll position
     for (const auto& character : characters) {
-        QList<QStandardItem*> items;
-        items << new QStandardItem(QString::number(character.id));
-        items << new QStandardItem(QString::fromStdString(character.name));
-        items << new QStandardItem(QString::fromStdString(character.surname));
-        items << new QStandardItem(QString::number(character.age));
-        items << new QStandardItem(QString::fromStdString(character.bio));
-        m_model->appendRow(items);
+        m_prefetcher->invalidate(character.id);
+        // Edited out of the filter, the limit is only applied on refresh
+        if (!m_filter.matches(character)) {
+            m_model->removeCharacter(character.id);
+            continue;
+        }
+        m_model->upsertCharacter(character);
     }
+    scheduleStats();
+}
+
+void MainWindow::slotCharactersRemoved(const std::vector<int32_t>& ids) {
+    for (int32_t id : ids) {
+        m_prefetcher->invalidate(id);
+    }
+    m_model->removeCharacters(ids);
+    scheduleStats();
 }
 
 void MainWindow::slotCharacterReceived(const CharacterData& character) {
+    m_pendingInfoId = -1;
+    // Full record, replaces the bio preview
+    m_model->updateCharacter(character);
+    openCharacterDialog(character);
+}
+
+void MainWindow::slotDetailsPrefetched(const CharacterData& character) {
+    m_model->updateCharacter(character);
+    // The user asked while the prefetch was already on the wire
+    if (character.id == m_pendingInfoId) {
+        m_pendingInfoId = -1;
+        openCharacterDialog(character);
+    }
+}
+
+void MainWindow::slotPrefetchFailed(int id) {
+    // Ask again in the foreground, the user sees the record or the actual error
+    if (id == m_pendingInfoId) {
+        showCharacterInfo(id);
+    }
+}
+
+void MainWindow::slotStatsReceived(const CharacterStats& stats) {
+    QString text = QString("%1 characters, mean age %2").arg(stats.count).arg(stats.meanAge(), 0, 'f', 1);
+    if (!stats.topSurnames.empty()) {
+        text += QString(", %1 surnames").arg(stats.distinctSurnames);
+    }
+    m_statsLabel->setText(text);
+
+    QStringList surnames;
+    for (const auto& surname : stats.topSurnames) {
+        surnames << QString("%1: %2").arg(QString::fromStdString(surname.first)).arg(surname.second);
+    }
+    m_statsLabel->setToolTip(surnames.isEmpty() ? QString() : "Most common surnames\n" + surnames.join('\n'));
+}
+
+void MainWindow::slotStatsFailed(const QString& message) {
+    // Not worth a dialog, the table itself is unaffected
+    m_statsLabel->setText(QString());
+    m_statsLabel->setToolTip(message);
+}
+
+void MainWindow::slotApplyFilterClicked() {
+    CharacterQuery filter;
+    filter.minAge = static_cast<uint8_t>(ui->minAgeSpin->value());
+    if (ui->maxAgeSpin->value() != 0) {
+        filter.maxAge = static_cast<uint8_t>(ui->maxAgeSpin->value());
+    }
+    filter.namePrefix = ui->namePrefixEdit->text().trimmed().toStdString();
+    filter.surnamePrefix = ui->surnamePrefixEdit->text().trimmed().toStdString();
+    filter.bioSubstring = ui->bioFilterEdit->text().toStdString();
+    filter.limit = static_cast<uint32_t>(ui->limitSpin->value());
+    if (filter.minAge > filter.maxAge) {
+        showError("Minimum age exceeds maximum age");
+        return;
+    }
+
+    m_filter = filter;
+    refreshCharacters();
+}
+
+void MainWindow::slotClearFilterClicked() {
+    ui->minAgeSpin->setValue(0);
+    ui->maxAgeSpin->setValue(0);
+    ui->namePrefixEdit->clear();
+    ui->surnamePrefixEdit->clear();
+    ui->bioFilterEdit->clear();
+    ui->limitSpin->setValue(0);
+    if (m_filter.isEmpty()) {
+        return;
+    }
+    m_filter = CharacterQuery();
+    refreshCharacters();
+}
+
+void MainWindow::openCharacterDialog(const CharacterData& character) {
     CharacterInfoDialog dialog(character, this);
     connect(
                 &dialog, &CharacterInfoDialog::signalRemoveRequested,
@@ -102,11 +417,18 @@ void MainWindow::slotCharacterReceived(const CharacterData& character) {
 void MainWindow::slotOperationCompleted(bool success, const QString& message) {
     if (!success) {
         showError(message);
-    } else {
+    } else if (!m_connection->isSubscribed()) {
+        // Subscribed clients get the change pushed, no need to poll
         refreshCharacters();
     }
 }
 
+void MainWindow::slotCellDoubleClicked(const QModelIndex& index) {
+    if (index.column() == CharacterTableModel::ColumnBio && m_model->isBioTruncated(index.row())) {
+        m_connection->prefetchCharacter(m_model->idAt(index.row()));
+    }
+}
+
 void MainWindow::slotShowInfoClicked() {
     QModelIndexList selected = ui->tableView->selectionModel()->selectedRows();
     if (selected.isEmpty()) {
@@ -114,8 +436,16 @@ void MainWindow::slotShowInfoClicked() {
         return;
     }
 
-    int id = m_model->item(selected.first().row(), 0)->text().toInt();
-    showCharacterInfo(id);
+    int id = m_model->idAt(selected.first().row());
+    CharacterData character;
+    if (m_prefetcher->cached(id, character)) {
+        openCharacterDialog(character);
+        return;
+    }
+    m_pendingInfoId = id;
+    if (!m_prefetcher->isInFlight(id)) {
+        showCharacterInfo(id);
+    }
 }
 
 void MainWindow::slotAddClicked() {
@@ -126,6 +456,77 @@ void MainWindow::slotAddClicked() {
     }
 }
 
+void MainWindow::slotImportClicked() {
+    QString path = QFileDialog::getOpenFileName(
+                this, "Import Characters", QString(),
+                "Character files (*.csv *.ndjson *.jsonl);;All files (*)"
+                );
+    if (path.isEmpty()) {
+        return;
+    }
+
+    QString error;
+    if (!m_importer->start(path, error)) {
+        showError("Import failed: " + error);
+        return;
+    }
+    ui->importButton->setEnabled(false);
+}
+
+void MainWindow::slotImportProgress(qint64 bytesParsed, qint64 bytesTotal, quint64 imported, quint64 rejected,
+                                    double recordsPerSecond) {
+    int percent = bytesTotal > 0 ? static_cast<int>(bytesParsed * 100 / bytesTotal) : 100;
+    ui->statusbar->showMessage(
+                QString("Importing: %1% read, %2 imported, %3 rejected, %4 records/s")
+                .arg(percent).arg(imported).arg(rejected).arg(recordsPerSecond, 0, 'f', 0)
+                );
+}
+
+void MainWindow::slotImportFinished(quint64 imported, quint64 rejected, const QString& error) {
+    ui->importButton->setEnabled(true);
+    ui->statusbar->showMessage(QString("Import done: %1 imported, %2 rejected").arg(imported).arg(rejected));
+    if (!error.isEmpty()) {
+        showError("Import failed: " + error);
+    }
+    // Batches don't trigger refreshes, catch up once at the end
+    if (imported > 0 && !m_connection->isSubscribed()) {
+        refreshCharacters();
+    }
+}
+
+void MainWindow::slotExportClicked() {
+    QString path = QFileDialog::getSaveFileName(
+                this, "Export Characters", QString(),
+                "CSV files (*.csv);;NDJSON files (*.ndjson *.jsonl)"
+                );
+    if (path.isEmpty()) {
+        return;
+    }
+
+    QString error;
+    if (!m_exporter->start(path, error)) {
+        showError("Export failed: " + error);
+        return;
+    }
+    ui->exportButton->setEnabled(false);
+}
+
+void MainWindow::slotExportProgress(quint64 exported, qint64 bytesWritten) {
+    ui->statusbar->showMessage(
+                QString("Exporting: %1 records, %2 KiB written").arg(exported).arg(bytesWritten / 1024)
+                );
+}
+
+void MainWindow::slotExportFinished(quint64 exported, const QString& error) {
+    ui->exportButton->setEnabled(true);
+    if (!error.isEmpty()) {
+        ui->statusbar->clearMessage();
+        showError("Export failed: " + error);
+        return;
+    }
+    ui->statusbar->showMessage(QString("Export done: %1 records").arg(exported));
+}
+
 void MainWindow::showCharacterInfo(int id) {
     m_connection->getCharacter(id);
 }
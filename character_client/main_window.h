@@ -6,9 +6,14 @@
 #ifndef MAIN_WINDOW_H
 #define MAIN_WINDOW_H
 
+#include <QLabel>
 #include <QMainWindow>
-#include <QStandardItemModel>
+#include <QTimer>
+#include "bulk_importer.h"
+#include "character_table_model.h"
 #include "client_connection.h"
+#include "detail_prefetcher.h"
+#include "roster_exporter.h"
 
 namespace Ui {
 class MainWindow;
@@ -22,27 +27,69 @@ class MainWindow : public QMainWindow {
     Q_OBJECT
 
 public:
-    explicit MainWindow(QWidget* parent = nullptr);
+    /**
+     * @brief Constructs the window and connects to the servers
+     * @param endpoints Comma-separated host[:port] list, the primary first,
+     * read replicas after it
+     * @param parent Optional parent widget
+     * @see ClientConnection::parseEndpoints()
+     */
+    explicit MainWindow(const QString& endpoints = "10.0.2.5", QWidget* parent = nullptr);
     ~MainWindow();
 
 private slots:
     void slotConnectionEstablished();
     void slotConnectionFailed(const QString& error);
-    void slotCharactersReceived(const std::vector<CharacterData>& characters);
+    void slotCharactersChunk(int streamId, const std::vector<CharacterData>& characters);
+    void slotColumnsChunk(int streamId, const CharacterColumns& columns);
+    void slotStreamFinished(int streamId, bool success, const QString& message);
     void slotCharacterReceived(const CharacterData& character);
+    void slotSubscriptionChanged(bool active);
+    void slotCharactersChanged(const std::vector<CharacterData>& characters);
+    void slotCharactersRemoved(const std::vector<int32_t>& ids);
     void slotOperationCompleted(bool success, const QString& message);
+    void slotDetailsPrefetched(const CharacterData& character);
+    void slotPrefetchFailed(int id);
+    void slotStatsReceived(const CharacterStats& stats);
+    void slotStatsFailed(const QString& message);
+    void slotApplyFilterClicked();
+    void slotClearFilterClicked();
+    void slotCellDoubleClicked(const QModelIndex& index);
     void slotShowInfoClicked();
     void slotAddClicked();
+    void slotImportClicked();
+    void slotImportProgress(qint64 bytesParsed, qint64 bytesTotal, quint64 imported, quint64 rejected,
+                            double recordsPerSecond);
+    void slotImportFinished(quint64 imported, quint64 rejected, const QString& error);
+    void slotExportClicked();
+    void slotExportProgress(quint64 exported, qint64 bytesWritten);
+    void slotExportFinished(quint64 exported, const QString& error);
 
 private:
     void setupTable();
     void refreshCharacters();
+    std::vector<CharacterData> filterLocally(std::vector<CharacterData> characters);
+    void scheduleStats();
+    size_t loadedBioLength() const;
     void showCharacterInfo(int id);
+    void openCharacterDialog(const CharacterData& character);
     void showError(const QString& message);
 
     Ui::MainWindow* ui;
     ClientConnection* m_connection;
-    QStandardItemModel* m_model;
+    CharacterTableModel* m_model;
+    DetailPrefetcher* m_prefetcher;
+    BulkImporter* m_importer;
+    RosterExporter* m_exporter;
+    QLabel* m_statsLabel;
+    QTimer* m_statsTimer;
+    int m_pendingInfoId = -1;
+    int m_rosterStreamId = 0;
+    bool m_rosterStarted = false;
+    CharacterQuery m_filter;
+    bool m_filterLocally = false;
+    uint16_t m_rosterBioLength = 0;
+    size_t m_filterMatched = 0;
 };
 
 #endif // MAIN_WINDOW_H
@@ -1,6 +1,9 @@
 #include "protocol.h"
 
+#include <algorithm>
 #include <cstring>
+#include <stdexcept>
+#include <unordered_map>
 
 // Helper method to write primitive types to buffer
 template<typename T>
@@ -12,6 +15,9 @@ void write_to_buffer(std::vector<uint8_t>& buffer, const T& value) {
 // Helper methods to read primitive types from buffer
 template<typename T>
 T read_from_buffer(const std::vector<uint8_t>& buffer, size_t& offset) {
+    if (offset > buffer.size() || buffer.size() - offset < sizeof(T)) {
+        throw std::out_of_range("Truncated buffer");
+    }
     T value;
     memcpy(&value, buffer.data() + offset, sizeof(T));
     offset += sizeof(T);
@@ -26,6 +32,9 @@ void CharacterData::write_string(std::vector<uint8_t>& buffer, const std::string
 
 std::string CharacterData::read_string(const std::vector<uint8_t>& buffer, size_t& offset) {
     uint32_t length = read_from_buffer<uint32_t>(buffer, offset);
+    if (length > buffer.size() - offset) {
+        throw std::out_of_range("Truncated string");
+    }
     std::string str(buffer.begin() + offset, buffer.begin() + offset + length);
     offset += length;
     return str;
@@ -86,11 +95,18 @@ std::vector<uint8_t> CharacterData::serializeVector(const std::vector<CharacterD
 std::vector<CharacterData> CharacterData::deserializeVector(const std::vector<uint8_t>& data) {
     size_t offset = 0;
     uint32_t count = read_from_buffer<uint32_t>(data, offset);
+    // Each record takes at least its size prefix, never reserve past that
+    if (count > (data.size() - offset) / sizeof(uint32_t)) {
+        throw std::out_of_range("Record count exceeds payload");
+    }
     std::vector<CharacterData> characters;
     characters.reserve(count);
 
     for (uint32_t i = 0; i < count; ++i) {
         uint32_t size = read_from_buffer<uint32_t>(data, offset);
+        if (size > data.size() - offset) {
+            throw std::out_of_range("Truncated record");
+        }
         std::vector<uint8_t> char_data(data.begin() + offset,
                                       data.begin() + offset + size);
         characters.push_back(deserialize(char_data));
@@ -99,3 +115,521 @@ std::vector<CharacterData> CharacterData::deserializeVector(const std::vector<ui
 
     return characters;
 }
+
+std::vector<uint8_t> CharacterData::serializeIds(const std::vector<int32_t>& ids) {
+    std::vector<uint8_t> buffer;
+    buffer.reserve(sizeof(uint32_t) + ids.size() * sizeof(int32_t));
+    write_to_buffer(buffer, static_cast<uint32_t>(ids.size()));
+    for (int32_t id : ids) {
+        write_to_buffer(buffer, id);
+    }
+    return buffer;
+}
+
+std::vector<int32_t> CharacterData::deserializeIds(const std::vector<uint8_t>& data) {
+    size_t offset = 0;
+    uint32_t count = read_from_buffer<uint32_t>(data, offset);
+    if (count > (data.size() - offset) / sizeof(int32_t)) {
+        throw std::out_of_range("ID count exceeds payload");
+    }
+    std::vector<int32_t> ids;
+    ids.reserve(count);
+
+    for (uint32_t i = 0; i < count; ++i) {
+        ids.push_back(read_from_buffer<int32_t>(data, offset));
+    }
+
+    return ids;
+}
+
+namespace {
+// Maps signed ids onto unsigned so small negatives stay short
+uint32_t zigzag_encode(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+int32_t zigzag_decode(uint32_t value) {
+    return static_cast<int32_t>((value >> 1) ^ (~(value & 1) + 1));
+}
+
+std::string read_string_compact(const std::vector<uint8_t>& buffer, size_t& offset) {
+    uint32_t length = CharacterData::read_varint(buffer, offset);
+    if (length > buffer.size() - offset) {
+        throw std::out_of_range("Truncated string");
+    }
+    std::string str(reinterpret_cast<const char*>(buffer.data() + offset), length);
+    offset += length;
+    return str;
+}
+
+void write_string_compact(std::vector<uint8_t>& buffer, const std::string& str) {
+    CharacterData::write_varint(buffer, static_cast<uint32_t>(str.size()));
+    buffer.insert(buffer.end(), str.begin(), str.end());
+}
+
+// id, three string lengths and age take at least one byte each
+constexpr size_t MIN_COMPACT_RECORD_SIZE = 5;
+}
+
+void CharacterData::write_varint(std::vector<uint8_t>& buffer, uint32_t value) {
+    while (value >= 0x80) {
+        buffer.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back(static_cast<uint8_t>(value));
+}
+
+uint32_t CharacterData::read_varint(const std::vector<uint8_t>& buffer, size_t& offset) {
+    uint32_t value = 0;
+    // uint32_t fits in 5 groups of 7 bits
+    for (unsigned shift = 0; shift < 35; shift += 7) {
+        if (offset >= buffer.size()) {
+            throw std::out_of_range("Truncated varint");
+        }
+        uint8_t byte = buffer[offset++];
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    throw std::out_of_range("Varint too long");
+}
+
+void CharacterData::writeCompact(std::vector<uint8_t>& buffer) const {
+    write_varint(buffer, zigzag_encode(id));
+    write_string_compact(buffer, name);
+    write_string_compact(buffer, surname);
+    buffer.push_back(age);
+    write_string_compact(buffer, bio);
+}
+
+std::vector<uint8_t> CharacterData::serializeCompact() const {
+    std::vector<uint8_t> buffer;
+    // Worst case varint is 5 bytes, 1 byte age
+    buffer.reserve(5 * 4 + 1 + name.size() + surname.size() + bio.size());
+    writeCompact(buffer);
+    return buffer;
+}
+
+CharacterData CharacterData::readCompact(const std::vector<uint8_t>& buffer, size_t& offset) {
+    CharacterData character;
+    character.id = zigzag_decode(read_varint(buffer, offset));
+    character.name = read_string_compact(buffer, offset);
+    character.surname = read_string_compact(buffer, offset);
+    if (offset >= buffer.size()) {
+        throw std::out_of_range("Truncated record");
+    }
+    character.age = buffer[offset++];
+    character.bio = read_string_compact(buffer, offset);
+    return character;
+}
+
+CharacterData CharacterData::deserializeCompact(const std::vector<uint8_t>& data) {
+    size_t offset = 0;
+    return readCompact(data, offset);
+}
+
+std::vector<uint8_t> CharacterData::serializeVectorCompact(const std::vector<CharacterData>& characters) {
+    std::vector<uint8_t> buffer;
+    write_varint(buffer, static_cast<uint32_t>(characters.size()));
+    for (const auto& character : characters) {
+        character.writeCompact(buffer);
+    }
+    return buffer;
+}
+
+std::vector<CharacterData> CharacterData::deserializeVectorCompact(const std::vector<uint8_t>& data) {
+    size_t offset = 0;
+    uint32_t count = read_varint(data, offset);
+    // Never trust the count further than the bytes that back it
+    if (count > (data.size() - offset) / MIN_COMPACT_RECORD_SIZE) {
+        throw std::out_of_range("Record count exceeds payload");
+    }
+    std::vector<CharacterData> characters;
+    characters.reserve(count);
+
+    // Records are decoded in place, without a per-record copy
+    for (uint32_t i = 0; i < count; ++i) {
+        characters.push_back(readCompact(data, offset));
+    }
+
+    return characters;
+}
+
+namespace {
+// Copies a fixed-width array out of the buffer in one go
+template<typename T>
+void read_array(const std::vector<uint8_t>& buffer, size_t& offset, T* out, size_t count) {
+    if (count > (buffer.size() - offset) / sizeof(T)) {
+        throw std::out_of_range("Truncated column");
+    }
+    memcpy(out, buffer.data() + offset, count * sizeof(T));
+    offset += count * sizeof(T);
+}
+
+// Reads a uint32_t at a position if the buffer reaches that far
+bool peek_uint32(const std::vector<uint8_t>& buffer, uint64_t at, uint32_t& value) {
+    if (at > buffer.size() || buffer.size() - at < sizeof(value)) {
+        return false;
+    }
+    memcpy(&value, buffer.data() + at, sizeof(value));
+    return true;
+}
+
+template<typename T>
+void write_array(std::vector<uint8_t>& buffer, const T* values, size_t count) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(values);
+    buffer.insert(buffer.end(), bytes, bytes + count * sizeof(T));
+}
+
+void write_string_column(std::vector<uint8_t>& buffer, const std::vector<std::string>& column,
+                         size_t begin, size_t end) {
+    std::unordered_map<std::string, uint32_t> dictionary;
+    std::vector<const std::string*> entries;
+    std::vector<uint32_t> codes;
+    codes.reserve(end - begin);
+
+    for (size_t i = begin; i < end; ++i) {
+        auto inserted = dictionary.emplace(column[i], static_cast<uint32_t>(entries.size()));
+        if (inserted.second) {
+            entries.push_back(&inserted.first->first);
+        }
+        codes.push_back(inserted.first->second);
+    }
+
+    std::vector<uint32_t> offsets;
+    offsets.reserve(entries.size() + 1);
+    uint32_t heapSize = 0;
+    for (const std::string* entry : entries) {
+        offsets.push_back(heapSize);
+        heapSize += static_cast<uint32_t>(entry->size());
+    }
+    offsets.push_back(heapSize);
+
+    write_to_buffer(buffer, static_cast<uint32_t>(entries.size()));
+    write_array(buffer, offsets.data(), offsets.size());
+    for (const std::string* entry : entries) {
+        buffer.insert(buffer.end(), entry->begin(), entry->end());
+    }
+    write_array(buffer, codes.data(), codes.size());
+}
+
+void read_string_column(const std::vector<uint8_t>& buffer, size_t& offset,
+                        std::vector<std::string>& column, size_t rows) {
+    uint32_t dictionarySize = 0;
+    read_array(buffer, offset, &dictionarySize, 1);
+    if (dictionarySize > (buffer.size() - offset) / sizeof(uint32_t)) {
+        throw std::out_of_range("Dictionary size exceeds payload");
+    }
+
+    std::vector<uint32_t> offsets(dictionarySize + 1);
+    read_array(buffer, offset, offsets.data(), offsets.size());
+    const uint32_t heapSize = offsets.back();
+    if (heapSize > buffer.size() - offset) {
+        throw std::out_of_range("Truncated string heap");
+    }
+    const char* heap = reinterpret_cast<const char*>(buffer.data() + offset);
+    offset += heapSize;
+
+    std::vector<std::string> dictionary;
+    dictionary.reserve(dictionarySize);
+    for (uint32_t i = 0; i < dictionarySize; ++i) {
+        if (offsets[i] > offsets[i + 1] || offsets[i + 1] > heapSize) {
+            throw std::out_of_range("Invalid string offsets");
+        }
+        dictionary.emplace_back(heap + offsets[i], offsets[i + 1] - offsets[i]);
+    }
+
+    std::vector<uint32_t> codes(rows);
+    read_array(buffer, offset, codes.data(), rows);
+    for (uint32_t code : codes) {
+        if (code >= dictionarySize) {
+            throw std::out_of_range("Invalid dictionary code");
+        }
+        column.push_back(dictionary[code]);
+    }
+}
+}
+
+void CharacterColumns::reserve(size_t rows) {
+    ids.reserve(rows);
+    ages.reserve(rows);
+    names.reserve(rows);
+    surnames.reserve(rows);
+    bios.reserve(rows);
+}
+
+void CharacterColumns::append(const CharacterData& character) {
+    ids.push_back(character.id);
+    ages.push_back(character.age);
+    names.push_back(character.name);
+    surnames.push_back(character.surname);
+    bios.push_back(character.bio);
+}
+
+void CharacterColumns::extend(const CharacterColumns& other) {
+    ids.insert(ids.end(), other.ids.begin(), other.ids.end());
+    ages.insert(ages.end(), other.ages.begin(), other.ages.end());
+    names.insert(names.end(), other.names.begin(), other.names.end());
+    surnames.insert(surnames.end(), other.surnames.begin(), other.surnames.end());
+    bios.insert(bios.end(), other.bios.begin(), other.bios.end());
+}
+
+CharacterData CharacterColumns::row(size_t row) const {
+    CharacterData character;
+    character.id = ids[row];
+    character.name = names[row];
+    character.surname = surnames[row];
+    character.age = ages[row];
+    character.bio = bios[row];
+    return character;
+}
+
+std::vector<uint8_t> CharacterColumns::serialize(size_t groupRows) const {
+    std::vector<uint8_t> buffer;
+    if (groupRows == 0) {
+        groupRows = DEFAULT_GROUP_ROWS;
+    }
+
+    for (size_t begin = 0; begin < size(); begin += groupRows) {
+        size_t end = std::min(size(), begin + groupRows);
+        write_to_buffer(buffer, static_cast<uint32_t>(end - begin));
+        write_array(buffer, ids.data() + begin, end - begin);
+        write_array(buffer, ages.data() + begin, end - begin);
+        write_string_column(buffer, names, begin, end);
+        write_string_column(buffer, surnames, begin, end);
+        write_string_column(buffer, bios, begin, end);
+    }
+    // Terminating empty group
+    write_to_buffer(buffer, static_cast<uint32_t>(0));
+
+    return buffer;
+}
+
+size_t CharacterColumns::readGroup(const std::vector<uint8_t>& data, size_t& offset) {
+    uint32_t rows = 0;
+    read_array(data, offset, &rows, 1);
+    if (rows == 0) {
+        return 0;
+    }
+    // id and age alone take 5 bytes per row
+    if (rows > (data.size() - offset) / (sizeof(int32_t) + sizeof(uint8_t))) {
+        throw std::out_of_range("Row count exceeds payload");
+    }
+
+    const size_t first = size();
+    ids.resize(first + rows);
+    ages.resize(first + rows);
+    // Fixed-width columns are copied in bulk
+    read_array(data, offset, ids.data() + first, rows);
+    read_array(data, offset, ages.data() + first, rows);
+    read_string_column(data, offset, names, rows);
+    read_string_column(data, offset, surnames, rows);
+    read_string_column(data, offset, bios, rows);
+
+    return rows;
+}
+
+size_t CharacterColumns::groupSize(const std::vector<uint8_t>& data, size_t offset) {
+    // Follows the size fields only, 64 bits cannot overflow on any of them
+    uint64_t end = offset;
+    uint32_t rows = 0;
+    if (!peek_uint32(data, end, rows)) {
+        return 0;
+    }
+    end += sizeof(rows);
+    if (rows == 0) {
+        return sizeof(rows);
+    }
+    end += uint64_t{rows} * (sizeof(int32_t) + sizeof(uint8_t));
+
+    // name, surname and bio
+    for (int column = 0; column < 3; ++column) {
+        uint32_t dictionarySize = 0;
+        uint32_t heapSize = 0;
+        if (!peek_uint32(data, end, dictionarySize)) {
+            return 0;
+        }
+        // Last offset, the heap size
+        end += sizeof(dictionarySize) + uint64_t{dictionarySize} * sizeof(uint32_t);
+        if (!peek_uint32(data, end, heapSize)) {
+            return 0;
+        }
+        end += sizeof(heapSize) + heapSize + uint64_t{rows} * sizeof(uint32_t);
+    }
+    return end <= data.size() ? static_cast<size_t>(end - offset) : 0;
+}
+
+CharacterColumns CharacterColumns::deserialize(const std::vector<uint8_t>& data) {
+    CharacterColumns columns;
+    size_t offset = 0;
+    while (columns.readGroup(data, offset) != 0) {
+    }
+    return columns;
+}
+
+double CharacterStats::meanAge() const {
+    if (count == 0) {
+        return 0.0;
+    }
+    uint64_t total = 0;
+    for (const auto& bucket : ageHistogram) {
+        total += static_cast<uint64_t>(bucket.first) * bucket.second;
+    }
+    return static_cast<double>(total) / count;
+}
+
+std::vector<uint8_t> CharacterStats::serialize() const {
+    std::vector<uint8_t> buffer;
+    CharacterData::write_varint(buffer, count);
+
+    CharacterData::write_varint(buffer, static_cast<uint32_t>(ageHistogram.size()));
+    for (const auto& bucket : ageHistogram) {
+        buffer.push_back(bucket.first);
+        CharacterData::write_varint(buffer, bucket.second);
+    }
+
+    CharacterData::write_varint(buffer, distinctSurnames);
+    CharacterData::write_varint(buffer, static_cast<uint32_t>(topSurnames.size()));
+    for (const auto& surname : topSurnames) {
+        write_string_compact(buffer, surname.first);
+        CharacterData::write_varint(buffer, surname.second);
+    }
+    return buffer;
+}
+
+CharacterStats CharacterStats::deserialize(const std::vector<uint8_t>& data) {
+    CharacterStats stats;
+    size_t offset = 0;
+    stats.count = CharacterData::read_varint(data, offset);
+
+    // One bucket per possible age at most
+    const uint32_t buckets = CharacterData::read_varint(data, offset);
+    if (buckets > 256) {
+        throw std::out_of_range("Bucket count exceeds age range");
+    }
+    stats.ageHistogram.reserve(buckets);
+    for (uint32_t i = 0; i < buckets; ++i) {
+        if (offset >= data.size()) {
+            throw std::out_of_range("Truncated histogram");
+        }
+        const uint8_t age = data[offset++];
+        stats.ageHistogram.emplace_back(age, CharacterData::read_varint(data, offset));
+    }
+
+    stats.distinctSurnames = CharacterData::read_varint(data, offset);
+    const uint32_t surnames = CharacterData::read_varint(data, offset);
+    // Length and count take at least one byte each
+    if (surnames > (data.size() - offset) / 2) {
+        throw std::out_of_range("Surname count exceeds payload");
+    }
+    stats.topSurnames.reserve(surnames);
+    for (uint32_t i = 0; i < surnames; ++i) {
+        std::string surname = read_string_compact(data, offset);
+        stats.topSurnames.emplace_back(std::move(surname), CharacterData::read_varint(data, offset));
+    }
+    return stats;
+}
+
+namespace {
+// Compares ASCII letters without regard to case, other bytes exactly
+bool same_folded(char a, char b) {
+    auto fold = [](char c) {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    };
+    return fold(a) == fold(b);
+}
+
+bool starts_with_folded(const std::string& str, const std::string& prefix) {
+    return prefix.size() <= str.size()
+            && std::equal(prefix.begin(), prefix.end(), str.begin(), same_folded);
+}
+
+bool contains_folded(const std::string& str, const std::string& part) {
+    return std::search(str.begin(), str.end(), part.begin(), part.end(), same_folded) != str.end();
+}
+}
+
+bool CharacterQuery::isEmpty() const {
+    return minAge == 0 && maxAge == 255 && namePrefix.empty() && surnamePrefix.empty()
+            && bioSubstring.empty() && limit == 0;
+}
+
+bool CharacterQuery::matches(const CharacterData& character) const {
+    return character.age >= minAge && character.age <= maxAge
+            && starts_with_folded(character.name, namePrefix)
+            && starts_with_folded(character.surname, surnamePrefix)
+            && contains_folded(character.bio, bioSubstring);
+}
+
+void CharacterQuery::write(std::vector<uint8_t>& buffer) const {
+    uint8_t conditions = 0;
+    if (minAge != 0 || maxAge != 255) {
+        conditions |= CONDITION_AGE;
+    }
+    if (!namePrefix.empty()) {
+        conditions |= CONDITION_NAME;
+    }
+    if (!surnamePrefix.empty()) {
+        conditions |= CONDITION_SURNAME;
+    }
+    if (!bioSubstring.empty()) {
+        conditions |= CONDITION_BIO;
+    }
+
+    buffer.push_back(conditions);
+    if (conditions & CONDITION_AGE) {
+        buffer.push_back(minAge);
+        buffer.push_back(maxAge);
+    }
+    if (conditions & CONDITION_NAME) {
+        write_string_compact(buffer, namePrefix);
+    }
+    if (conditions & CONDITION_SURNAME) {
+        write_string_compact(buffer, surnamePrefix);
+    }
+    if (conditions & CONDITION_BIO) {
+        write_string_compact(buffer, bioSubstring);
+    }
+    CharacterData::write_varint(buffer, limit);
+}
+
+CharacterQuery CharacterQuery::read(const std::vector<uint8_t>& buffer, size_t& offset) {
+    CharacterQuery query;
+    if (offset >= buffer.size()) {
+        throw std::out_of_range("Truncated query");
+    }
+    const uint8_t conditions = buffer[offset++];
+    if (conditions & CONDITION_AGE) {
+        if (buffer.size() - offset < 2) {
+            throw std::out_of_range("Truncated age range");
+        }
+        query.minAge = buffer[offset++];
+        query.maxAge = buffer[offset++];
+    }
+    if (conditions & CONDITION_NAME) {
+        query.namePrefix = read_string_compact(buffer, offset);
+    }
+    if (conditions & CONDITION_SURNAME) {
+        query.surnamePrefix = read_string_compact(buffer, offset);
+    }
+    if (conditions & CONDITION_BIO) {
+        query.bioSubstring = read_string_compact(buffer, offset);
+    }
+    query.limit = CharacterData::read_varint(buffer, offset);
+    return query;
+}
+
+uint32_t Protocol::acceptedFeatures(const std::vector<uint8_t>& answer, uint32_t offered) {
+    // Servers predating HELLO reject it, talk the original protocol
+    uint32_t accepted = 0;
+    if (!answer.empty() && answer[0] == HELLO && answer.size() >= 1 + sizeof(accepted)) {
+        memcpy(&accepted, answer.data() + 1, sizeof(accepted));
+    }
+    accepted &= offered;
+    // Columnar payloads are binary throughout, never delimit them
+    if (!(accepted & FEATURE_LENGTH_FRAMED)) {
+        accepted &= ~FEATURE_COLUMNAR;
+    }
+    return accepted;
+}
@@ -9,6 +9,7 @@
 #include <cstdint>
 #include <vector>
 #include <string>
+#include <utility>
 
 /**
  * \struct CharacterData
@@ -31,6 +32,7 @@ struct CharacterData {
      * \brief Deserializes a byte vector into a CharacterData object.
      * \param data A vector of bytes containing serialized character data.
      * \return A CharacterData object populated with the deserialized data.
+     * \throws std::out_of_range if a field runs past the end of the data.
      */
     static CharacterData deserialize(const std::vector<uint8_t>& data);
 
@@ -45,6 +47,7 @@ struct CharacterData {
      * \brief Deserializes a byte vector into a vector of CharacterData objects.
      * \param data A vector of bytes containing serialized character data.
      * \return A vector of CharacterData objects populated with the deserialized data.
+     * \throws std::out_of_range if the count or a record size exceeds the data.
      */
     static std::vector<CharacterData> deserializeVector(const std::vector<uint8_t>& data);
 
@@ -60,8 +63,270 @@ struct CharacterData {
      * \param buffer The buffer to read from.
      * \param offset The current offset in the buffer, which will be updated.
      * \return The read string.
+     * \throws std::out_of_range if the string runs past the end of the buffer.
      */
     static std::string read_string(const std::vector<uint8_t>& buffer, size_t& offset);
+
+    /**
+     * \brief Serializes a list of character IDs into a byte vector.
+     * \param ids The IDs to serialize.
+     * \return A vector of bytes holding the ID count followed by the IDs.
+     */
+    static std::vector<uint8_t> serializeIds(const std::vector<int32_t>& ids);
+
+    /**
+     * \brief Deserializes a list of character IDs from a byte vector.
+     * \param data A vector of bytes produced by serializeIds().
+     * \return The deserialized IDs.
+     * \throws std::out_of_range if the count exceeds the data.
+     */
+    static std::vector<int32_t> deserializeIds(const std::vector<uint8_t>& data);
+
+    /**
+     * \brief Serializes the CharacterData using the compact varint encoding.
+     * \return A vector of bytes representing the serialized character data.
+     * \see Protocol::FEATURE_VARINT_ENCODING
+     */
+    std::vector<uint8_t> serializeCompact() const;
+
+    /**
+     * \brief Appends the compact encoding of the CharacterData to a buffer.
+     * \param buffer The buffer to write to.
+     */
+    void writeCompact(std::vector<uint8_t>& buffer) const;
+
+    /**
+     * \brief Deserializes a compact-encoded byte vector into a CharacterData object.
+     * \param data A vector of bytes produced by serializeCompact().
+     * \return A CharacterData object populated with the deserialized data.
+     */
+    static CharacterData deserializeCompact(const std::vector<uint8_t>& data);
+
+    /**
+     * \brief Reads one compact-encoded CharacterData from a byte buffer.
+     * \param buffer The buffer to read from.
+     * \param offset The current offset in the buffer, which will be updated.
+     * \return The read character data.
+     * \throws std::out_of_range if the record runs past the end of the buffer.
+     */
+    static CharacterData readCompact(const std::vector<uint8_t>& buffer, size_t& offset);
+
+    /**
+     * \brief Serializes a vector of CharacterData objects using the compact encoding.
+     * \param characters A vector of CharacterData objects to serialize.
+     * \return A vector of bytes holding a varint count followed by the records.
+     */
+    static std::vector<uint8_t> serializeVectorCompact(const std::vector<CharacterData>& characters);
+
+    /**
+     * \brief Deserializes a compact-encoded byte vector into a vector of CharacterData objects.
+     * \param data A vector of bytes produced by serializeVectorCompact().
+     * \return A vector of CharacterData objects populated with the deserialized data.
+     */
+    static std::vector<CharacterData> deserializeVectorCompact(const std::vector<uint8_t>& data);
+
+    /**
+     * \brief Writes an unsigned LEB128 varint to a byte buffer.
+     * \param buffer The buffer to write to.
+     * \param value The value to write.
+     */
+    static void write_varint(std::vector<uint8_t>& buffer, uint32_t value);
+
+    /**
+     * \brief Reads an unsigned LEB128 varint from a byte buffer.
+     * \param buffer The buffer to read from.
+     * \param offset The current offset in the buffer, which will be updated.
+     * \return The read value.
+     * \throws std::out_of_range if the varint is truncated or longer than 5 bytes.
+     */
+    static uint32_t read_varint(const std::vector<uint8_t>& buffer, size_t& offset);
+};
+
+/**
+ * \struct CharacterColumns
+ * \brief Struct-of-arrays representation of a character roster
+ *
+ * \details Wire layout, answered to Protocol::GET_ALL_COLUMNAR, is a
+ * sequence of row groups terminated by a group of zero rows:
+ * - uint32_t rows
+ * - int32_t ids[rows]
+ * - uint8_t ages[rows]
+ * - for name, surname and bio: uint32_t dictionary size N,
+ *   uint32_t offsets[N + 1] into the string heap that follows,
+ *   the heap bytes, then uint32_t codes[rows] indexing the dictionary
+ *
+ * Every row group carries its own dictionaries, so a group can be
+ * decoded as soon as it has arrived.
+ */
+struct CharacterColumns {
+    std::vector<int32_t> ids{}; ///< Character identifiers
+    std::vector<uint8_t> ages{}; ///< Character ages
+    std::vector<std::string> names{}; ///< Character first names
+    std::vector<std::string> surnames{}; ///< Character surnames
+    std::vector<std::string> bios{}; ///< Character biographies
+
+    /**
+     * \brief Returns the number of rows.
+     * \return The row count.
+     */
+    size_t size() const { return ids.size(); }
+
+    /**
+     * \brief Reserves capacity in every column.
+     * \param rows The row count to reserve for.
+     */
+    void reserve(size_t rows);
+
+    /**
+     * \brief Appends a character as a new row.
+     * \param character The character to append.
+     */
+    void append(const CharacterData& character);
+
+    /**
+     * \brief Appends every row of another roster.
+     * \param other The rows to append.
+     */
+    void extend(const CharacterColumns& other);
+
+    /**
+     * \brief Assembles the character stored in a row.
+     * \param row The row index.
+     * \return The character data of that row.
+     */
+    CharacterData row(size_t row) const;
+
+    /**
+     * \brief Serializes the columns into row groups.
+     * \param groupRows Maximum number of rows per row group.
+     * \return A vector of bytes in the columnar wire layout.
+     */
+    std::vector<uint8_t> serialize(size_t groupRows = DEFAULT_GROUP_ROWS) const;
+
+    /**
+     * \brief Deserializes the columnar wire layout.
+     * \param data A vector of bytes produced by serialize().
+     * \return The decoded columns.
+     * \throws std::out_of_range if the data is truncated or inconsistent.
+     */
+    static CharacterColumns deserialize(const std::vector<uint8_t>& data);
+
+    /**
+     * \brief Decodes one row group and appends its rows.
+     * \param data The buffer to read from.
+     * \param offset The current offset in the buffer, which will be updated.
+     * \return The number of rows appended, zero for the terminating group.
+     * \throws std::out_of_range if the group is truncated or inconsistent.
+     */
+    size_t readGroup(const std::vector<uint8_t>& data, size_t& offset);
+
+    /**
+     * \brief Measures a row group from its size fields, without decoding it.
+     * \param data The buffer holding the group.
+     * \param offset Offset of the group in the buffer.
+     * \return The bytes the group takes, zero if the buffer does not hold all of it yet.
+     */
+    static size_t groupSize(const std::vector<uint8_t>& data, size_t offset);
+
+    static constexpr size_t DEFAULT_GROUP_ROWS = 4096; ///< Default rows per row group
+};
+
+/**
+ * \struct CharacterStats
+ * \brief Aggregates over the whole roster, answered to Protocol::STATS
+ *
+ * \details Wire layout, every varint as in CharacterData::write_varint():
+ * - varint character count
+ * - varint bucket count, then per bucket uint8_t age and varint
+ *   characters of that age, in ascending age
+ * - varint distinct surname count
+ * - varint surname count, then per surname varint length, bytes and
+ *   varint characters bearing it, most frequent first
+ *
+ * A few hundred bytes whatever the roster size.
+ */
+struct CharacterStats {
+    uint32_t count = 0; ///< Number of characters
+    std::vector<std::pair<uint8_t, uint32_t>> ageHistogram{}; ///< Characters per age, ages without any left out
+    uint32_t distinctSurnames = 0; ///< Number of different surnames
+    std::vector<std::pair<std::string, uint32_t>> topSurnames{}; ///< Most frequent surnames with their counts
+
+    /**
+     * \brief Returns the mean age.
+     * \return The mean age, 0 for an empty roster.
+     */
+    double meanAge() const;
+
+    /**
+     * \brief Serializes the aggregates.
+     * \return A vector of bytes in the wire layout.
+     */
+    std::vector<uint8_t> serialize() const;
+
+    /**
+     * \brief Deserializes the wire layout.
+     * \param data A vector of bytes produced by serialize().
+     * \return The decoded aggregates.
+     * \throws std::out_of_range if the data is truncated or inconsistent.
+     */
+    static CharacterStats deserialize(const std::vector<uint8_t>& data);
+
+    static constexpr size_t DEFAULT_SURNAME_LIMIT = 10; ///< Surnames sent when the request names no limit
+};
+
+/**
+ * \struct CharacterQuery
+ * \brief Predicate evaluated by the server, sent with Protocol::QUERY
+ *
+ * \details A character matches if it passes every condition that is set.
+ * Prefixes and the substring compare ASCII letters case-insensitively,
+ * other bytes as they are. Wire layout:
+ * - uint8_t mask of the CONDITION_* flags present
+ * - CONDITION_AGE: uint8_t minAge, uint8_t maxAge, both inclusive
+ * - CONDITION_NAME, CONDITION_SURNAME, CONDITION_BIO, in this order:
+ *   varint length and bytes of the prefix or substring
+ * - varint limit, 0 for none
+ */
+struct CharacterQuery {
+    uint8_t minAge = 0; ///< Youngest matching age
+    uint8_t maxAge = 255; ///< Oldest matching age
+    std::string namePrefix{}; ///< First names must start with this, empty for any
+    std::string surnamePrefix{}; ///< Surnames must start with this, empty for any
+    std::string bioSubstring{}; ///< Biographies must contain this, empty for any
+    uint32_t limit = 0; ///< Most characters returned, 0 for no limit
+
+    /**
+     * \brief Returns whether the query restricts anything.
+     * \return True if every character matches and there is no limit.
+     */
+    bool isEmpty() const;
+
+    /**
+     * \brief Tests a character against the conditions, the limit aside.
+     * \param character The character to test.
+     * \return True if the character matches.
+     */
+    bool matches(const CharacterData& character) const;
+
+    /**
+     * \brief Appends the encoded query to a buffer.
+     * \param buffer The buffer to write to.
+     */
+    void write(std::vector<uint8_t>& buffer) const;
+
+    /**
+     * \brief Reads an encoded query from a byte buffer.
+     * \param buffer The buffer to read from.
+     * \param offset The current offset in the buffer, which will be updated.
+     * \return The decoded query.
+     * \throws std::out_of_range if the query runs past the end of the buffer.
+     */
+    static CharacterQuery read(const std::vector<uint8_t>& buffer, size_t& offset);
+
+    static constexpr uint8_t CONDITION_AGE = 1u << 0; ///< Age range is present
+    static constexpr uint8_t CONDITION_NAME = 1u << 1; ///< First name prefix is present
+    static constexpr uint8_t CONDITION_SURNAME = 1u << 2; ///< Surname prefix is present
+    static constexpr uint8_t CONDITION_BIO = 1u << 3; ///< Biography substring is present
 };
 
 namespace Protocol {
@@ -71,6 +336,50 @@ constexpr uint8_t ADD_CHARACTER = 0x02; ///< Command to add a new character
 constexpr uint8_t REMOVE_CHARACTER = 0x03; ///< Command to remove a character
 constexpr uint8_t GET_ONE = 0x04; ///< Command to get a specific character
 constexpr uint8_t UPDATE_CHARACTER = 0x05; ///< Command to update character information
+constexpr uint8_t SUBSCRIBE = 0x06; ///< Command to subscribe to change notifications
+constexpr uint8_t HELLO = 0x07; ///< Command to negotiate protocol features
+constexpr uint8_t GET_ALL_COLUMNAR = 0x08; ///< Command to get all characters as CharacterColumns
+constexpr uint8_t ADD_CHARACTERS = 0x09; ///< Command to add a batch of characters, answered with a uint32_t added count
+constexpr uint8_t STATS = 0x0A; ///< Command to get CharacterStats, optional uint8_t payload limits the surnames
+constexpr uint8_t QUERY = 0x0B; ///< Command to get the characters matching a CharacterQuery, answered like GET_ALL
+
+// Unsolicited notifications, pushed by the server to subscribed clients
+constexpr uint8_t NOTIFY_CHANGED = 0x90; ///< Added or updated characters, serialized as a vector
+constexpr uint8_t NOTIFY_REMOVED = 0x91; ///< IDs of removed characters
+
+// Feature flags, negotiated with HELLO.
+// The client sends the uint32_t mask it supports, the server answers with the
+// subset it accepted. Servers that predate HELLO answer RESP_ERROR, which
+// means no features. Both HELLO messages themselves use delimiter framing.
+constexpr uint32_t FEATURE_LENGTH_FRAMED = 1u << 0; ///< Messages are prefixed with a uint32_t length instead of delimited
+constexpr uint32_t FEATURE_VARINT_ENCODING = 1u << 1; ///< Records use CharacterData::serializeCompact()
+constexpr uint32_t FEATURE_COLUMNAR = 1u << 2; ///< Server answers GET_ALL_COLUMNAR, requires length framing
+constexpr uint32_t FEATURE_PROJECTION = 1u << 3; ///< GET_ALL and GET_ALL_COLUMNAR accept a field projection
+constexpr uint32_t FEATURE_BATCH_ADD = 1u << 4; ///< Server accepts ADD_CHARACTERS
+constexpr uint32_t FEATURE_STATS = 1u << 5; ///< Server answers STATS
+constexpr uint32_t FEATURE_QUERY = 1u << 6; ///< Server answers QUERY
+
+/**
+ * \brief Reads the features a server accepted from its answer to HELLO
+ * \param answer Answer to HELLO, command byte first
+ * \param offered Features the HELLO offered
+ * \return Accepted features, 0 if the server rejected HELLO
+ *
+ * \note Anything not offered is dropped, so is FEATURE_COLUMNAR without
+ * FEATURE_LENGTH_FRAMED
+ */
+uint32_t acceptedFeatures(const std::vector<uint8_t>& answer, uint32_t offered);
+
+// Field projection for GET_ALL and GET_ALL_COLUMNAR, sent as the request
+// payload: uint8_t field mask, then uint16_t bio preview length in bytes
+// (0 sends bios whole). The id is always sent. Fields left out of the mask
+// are sent empty, so record layouts do not change.
+// QUERY always starts with the projection, the CharacterQuery follows it.
+constexpr uint8_t FIELD_NAME = 1u << 0; ///< Include first name
+constexpr uint8_t FIELD_SURNAME = 1u << 1; ///< Include surname
+constexpr uint8_t FIELD_AGE = 1u << 2; ///< Include age
+constexpr uint8_t FIELD_BIO = 1u << 3; ///< Include biography, possibly truncated
+constexpr uint8_t FIELD_ALL = FIELD_NAME | FIELD_SURNAME | FIELD_AGE | FIELD_BIO; ///< Include every field
 
 // Response codes
 constexpr uint8_t RESP_SUCCESS = 0x80; ///< Response indicating success
@@ -82,10 +391,8 @@ constexpr size_t MAX_CONNECTIONS = 1000; ///< Maximum number of concurrent conne
 constexpr size_t THREAD_POOL_SIZE = 16; ///< Size of the thread pool for handling requests
 
 // Timeouts (milliseconds)
-// 30000 seconds
-constexpr unsigned READ_TIMEOUT = 30'000'000; ///< Timeout for read operations
-// 10000 seconds
-constexpr unsigned WRITE_TIMEOUT = 10'000'000; ///< Timeout for write operations
+constexpr unsigned READ_TIMEOUT = 30'000; ///< Timeout for read operations
+constexpr unsigned WRITE_TIMEOUT = 10'000; ///< Timeout for write operations
 
 // Network settings
 // This is the hardcoded server port
@@ -0,0 +1,185 @@
+#include "roster_exporter.h"
+
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+namespace {
+// Quotes a CSV field if it contains a separator, quote or line break
+void append_csv_field(QByteArray& out, const std::string& field) {
+    if (field.find_first_of(",\"\r\n") == std::string::npos) {
+        out.append(field.data(), static_cast<int>(field.size()));
+        return;
+    }
+    out.append('"');
+    for (char c : field) {
+        if (c == '"') {
+            out.append('"');
+        }
+        out.append(c);
+    }
+    out.append('"');
+}
+}
+
+RosterExporter::RosterExporter(ClientConnection* connection, QObject* parent)
+    : QObject(parent), m_connection(connection)
+{
+    connect(
+                m_connection, &ClientConnection::signalCharactersChunk,
+                this, &RosterExporter::slotCharactersChunk
+                );
+    connect(
+                m_connection, &ClientConnection::signalColumnsChunk,
+                this, &RosterExporter::slotColumnsChunk
+                );
+    connect(
+                m_connection, &ClientConnection::signalStreamFinished,
+                this, &RosterExporter::slotStreamFinished
+                );
+}
+
+bool RosterExporter::start(const QString& path, QString& error) {
+    if (m_streamId != 0) {
+        error = "Export already running";
+        return false;
+    }
+
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    m_format = (suffix == "ndjson" || suffix == "jsonl") ? Format::Ndjson : Format::Csv;
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly)) {
+        error = m_file.errorString();
+        return false;
+    }
+
+    // Full records, the export must not carry bio previews
+    m_streamId = m_connection->streamAllCharacters();
+    if (m_streamId == 0) {
+        m_file.cancelWriting();
+        m_file.commit();
+        error = "Not connected to server";
+        return false;
+    }
+
+    m_exported = 0;
+    m_written = 0;
+    m_out.clear();
+    m_out.reserve(OUTPUT_BUFFER_SIZE * 2);
+    if (m_format == Format::Csv) {
+        m_out.append("id,name,surname,age,bio\n");
+    }
+    return true;
+}
+
+void RosterExporter::cancel() {
+    if (m_streamId != 0) {
+        m_connection->cancelRequest(m_streamId);
+        finish("Export cancelled");
+    }
+}
+
+void RosterExporter::slotCharactersChunk(int streamId, const std::vector<CharacterData>& characters) {
+    if (streamId != m_streamId || m_streamId == 0) {
+        return;
+    }
+
+    for (const auto& character : characters) {
+        if (!append(character)) {
+            // The rest of the roster would only be thrown away
+            m_connection->cancelRequest(m_streamId);
+            finish(m_file.errorString());
+            return;
+        }
+    }
+    emit signalProgress(m_exported, m_written);
+}
+
+void RosterExporter::slotColumnsChunk(int streamId, const CharacterColumns& columns) {
+    if (streamId != m_streamId || m_streamId == 0) {
+        return;
+    }
+
+    for (size_t row = 0; row < columns.size(); ++row) {
+        if (!append(columns.row(row))) {
+            m_connection->cancelRequest(m_streamId);
+            finish(m_file.errorString());
+            return;
+        }
+    }
+    emit signalProgress(m_exported, m_written);
+}
+
+bool RosterExporter::append(const CharacterData& character) {
+    if (m_format == Format::Csv) {
+        appendCsv(character);
+    } else {
+        appendNdjson(character);
+    }
+    ++m_exported;
+    return m_out.size() < OUTPUT_BUFFER_SIZE || flush();
+}
+
+void RosterExporter::slotStreamFinished(int streamId, bool success, const QString& message) {
+    if (streamId != m_streamId || m_streamId == 0) {
+        return;
+    }
+    finish(success ? QString() : message);
+}
+
+void RosterExporter::appendCsv(const CharacterData& character) {
+    m_out.append(QByteArray::number(character.id));
+    m_out.append(',');
+    append_csv_field(m_out, character.name);
+    m_out.append(',');
+    append_csv_field(m_out, character.surname);
+    m_out.append(',');
+    m_out.append(QByteArray::number(character.age));
+    m_out.append(',');
+    append_csv_field(m_out, character.bio);
+    m_out.append('\n');
+}
+
+void RosterExporter::appendNdjson(const CharacterData& character) {
+    QJsonObject object;
+    object.insert("id", character.id);
+    object.insert("name", QString::fromStdString(character.name));
+    object.insert("surname", QString::fromStdString(character.surname));
+    object.insert("age", character.age);
+    object.insert("bio", QString::fromStdString(character.bio));
+    m_out.append(QJsonDocument(object).toJson(QJsonDocument::Compact));
+    m_out.append('\n');
+}
+
+bool RosterExporter::flush() {
+    if (m_out.isEmpty()) {
+        return true;
+    }
+    if (m_file.write(m_out) != m_out.size()) {
+        return false;
+    }
+    m_written += m_out.size();
+    // Keeps the reserved capacity, clear() would release it
+    m_out.resize(0);
+    return true;
+}
+
+void RosterExporter::finish(const QString& error) {
+    // Chunks still on the wire for this stream are ignored from now on
+    m_streamId = 0;
+
+    QString result = error;
+    if (result.isEmpty() && (!flush() || !m_file.commit())) {
+        result = m_file.errorString();
+    }
+    if (!result.isEmpty()) {
+        // Committing after cancelWriting() discards the file and closes it
+        m_file.cancelWriting();
+        m_file.commit();
+    }
+    m_out.clear();
+
+    emit signalProgress(m_exported, m_written);
+    emit signalFinished(m_exported, result);
+}
@@ -0,0 +1,142 @@
+/**
+ * \file roster_exporter.h
+ * \brief Streaming export of the roster to CSV or NDJSON files
+ */
+
+#ifndef ROSTER_EXPORTER_H
+#define ROSTER_EXPORTER_H
+
+#include <QByteArray>
+#include <QObject>
+#include <QSaveFile>
+#include "client_connection.h"
+
+/**
+ * \class RosterExporter
+ * \brief Writes the server roster to disk while it is received
+ *
+ * \details Requests the roster with ClientConnection::streamAllCharacters()
+ * and writes each chunk of records as soon as it is decoded, through a
+ * fixed-size output buffer. Memory use does not depend on the roster size.
+ * The file only replaces the destination once the whole roster is written.
+ *
+ * Output format is picked by file suffix: .ndjson or .jsonl for one JSON
+ * object per line, CSV with an id,name,surname,age,bio header otherwise.
+ * Both are readable by BulkImporter.
+ */
+class RosterExporter : public QObject {
+    Q_OBJECT
+
+public:
+    /**
+     * \brief Supported output formats
+     */
+    enum class Format {
+        Csv,
+        Ndjson
+    };
+
+    /**
+     * \brief Constructs an idle exporter
+     * \param connection Connection the roster is requested through
+     * \param parent Optional QObject parent
+     */
+    explicit RosterExporter(ClientConnection* connection, QObject* parent = nullptr);
+
+    /**
+     * \brief Starts exporting the roster
+     * \param path Destination file
+     * \param error [out] Reason the export could not start
+     * \return bool True if the export started
+     *
+     * \note Emits signalFinished() when the roster is written or the export fails
+     */
+    bool start(const QString& path, QString& error);
+
+    /**
+     * \brief Stops the export and leaves the destination untouched
+     */
+    void cancel();
+
+signals:
+    /**
+     * \brief Emitted periodically while exporting
+     * \param exported Records written so far
+     * \param bytesWritten Bytes written so far
+     */
+    void signalProgress(quint64 exported, qint64 bytesWritten);
+
+    /**
+     * \brief Emitted when the export ends
+     * \param exported Records written
+     * \param error Empty on success, reason otherwise
+     */
+    void signalFinished(quint64 exported, const QString& error);
+
+private slots:
+    /**
+     * \brief Writes a chunk of decoded records
+     * \param streamId Stream the chunk belongs to
+     * \param characters Decoded records
+     */
+    void slotCharactersChunk(int streamId, const std::vector<CharacterData>& characters);
+
+    /**
+     * \brief Writes a row group of a columnar roster
+     * \param streamId Stream the group belongs to
+     * \param columns Rows of the group
+     */
+    void slotColumnsChunk(int streamId, const CharacterColumns& columns);
+
+    /**
+     * \brief Commits or discards the file when the stream ends
+     * \param streamId Stream that ended
+     * \param success True if every record was received
+     * \param message Error description on failure
+     */
+    void slotStreamFinished(int streamId, bool success, const QString& message);
+
+private:
+    /**
+     * \brief Appends one record in the output format
+     * \param character Record to write
+     * \return bool False on write error
+     */
+    bool append(const CharacterData& character);
+
+    /**
+     * \brief Appends one CSV line to the output buffer
+     * \param character Record to write
+     */
+    void appendCsv(const CharacterData& character);
+
+    /**
+     * \brief Appends one NDJSON line to the output buffer
+     * \param character Record to write
+     */
+    void appendNdjson(const CharacterData& character);
+
+    /**
+     * \brief Writes the output buffer to the file
+     * \return bool False on write error
+     */
+    bool flush();
+
+    /**
+     * \brief Commits or discards the file and emits signalFinished()
+     * \param error Empty on success, reason otherwise
+     */
+    void finish(const QString& error);
+
+    ClientConnection* m_connection;     ///< Connection the roster is requested through
+    QSaveFile m_file;                   ///< Destination, replaced on commit
+    QByteArray m_out;                   ///< Output buffer
+    Format m_format = Format::Csv;      ///< Output format
+    int m_streamId = 0;                 ///< Stream being exported, 0 when idle
+    quint64 m_exported = 0;             ///< Records written so far
+    qint64 m_written = 0;               ///< Bytes written so far
+
+    static constexpr int OUTPUT_BUFFER_SIZE = 64 * 1024; ///< Output buffer flush threshold
+};
+
+#endif // ROSTER_EXPORTER_H
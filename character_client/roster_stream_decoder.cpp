@@ -0,0 +1,117 @@
+#include "roster_stream_decoder.h"
+
+#include <cstring>
+#include <stdexcept>
+
+RosterStreamDecoder::RosterStreamDecoder(Layout layout)
+    : m_layout(layout)
+{
+}
+
+void RosterStreamDecoder::feed(const uint8_t* data, size_t size) {
+    compact();
+    // A record or group announcing more than the limit is never waited for
+    if (m_maxBuffered != 0 && m_buffer.size() + size > m_maxBuffered) {
+        throw std::length_error("Roster record exceeds size limit");
+    }
+    m_buffer.insert(m_buffer.end(), data, data + size);
+}
+
+bool RosterStreamDecoder::readCount() {
+    if (m_haveCount) {
+        return true;
+    }
+
+    size_t offset = m_offset;
+    if (m_layout == Layout::Plain) {
+        if (m_buffer.size() - offset < sizeof(m_count)) {
+            return false;
+        }
+        std::memcpy(&m_count, m_buffer.data() + offset, sizeof(m_count));
+        offset += sizeof(m_count);
+    } else {
+        try {
+            m_count = CharacterData::read_varint(m_buffer, offset);
+        } catch (const std::out_of_range&) {
+            return false;
+        }
+    }
+
+    m_offset = offset;
+    m_haveCount = true;
+    return true;
+}
+
+bool RosterStreamDecoder::next(CharacterData& character) {
+    if (m_layout == Layout::Columnar || !readCount() || m_decoded == m_count) {
+        return false;
+    }
+
+    size_t offset = m_offset;
+    if (m_layout == Layout::Plain) {
+        uint32_t size = 0;
+        if (m_buffer.size() - offset < sizeof(size)) {
+            return false;
+        }
+        std::memcpy(&size, m_buffer.data() + offset, sizeof(size));
+        offset += sizeof(size);
+        if (m_buffer.size() - offset < size) {
+            return false;
+        }
+        std::vector<uint8_t> record(m_buffer.begin() + offset, m_buffer.begin() + offset + size);
+        character = CharacterData::deserialize(record);
+        offset += size;
+    } else {
+        // Compact records carry no size, a truncated read means wait for more.
+        // A malformed record looks the same and surfaces as !atEnd() when
+        // the payload is over.
+        try {
+            character = CharacterData::readCompact(m_buffer, offset);
+        } catch (const std::out_of_range&) {
+            return false;
+        }
+    }
+
+    m_offset = offset;
+    ++m_decoded;
+    return true;
+}
+
+bool RosterStreamDecoder::nextGroup(CharacterColumns& columns) {
+    if (m_layout != Layout::Columnar || m_haveCount) {
+        return false;
+    }
+
+    // Groups carry no size, their size fields tell whether one is complete
+    // without decoding it, so it is decoded once
+    if (CharacterColumns::groupSize(m_buffer, m_offset) == 0) {
+        return false;
+    }
+    // Complete, an error now means the group is malformed
+    size_t offset = m_offset;
+    CharacterColumns group;
+    const size_t rows = group.readGroup(m_buffer, offset);
+
+    m_offset = offset;
+    if (rows == 0) {
+        // Terminating group, the row count is known now
+        m_haveCount = true;
+        m_count = m_decoded;
+        return false;
+    }
+    m_decoded += static_cast<uint32_t>(rows);
+    columns = std::move(group);
+    return true;
+}
+
+bool RosterStreamDecoder::atEnd() const {
+    return m_haveCount && m_decoded == m_count && m_offset == m_buffer.size();
+}
+
+void RosterStreamDecoder::compact() {
+    if (m_offset == 0) {
+        return;
+    }
+    m_buffer.erase(m_buffer.begin(), m_buffer.begin() + m_offset);
+    m_offset = 0;
+}
@@ -0,0 +1,115 @@
+/**
+ * \file roster_stream_decoder.h
+ * \brief Resumable decoder for GET_ALL payloads that arrive in pieces
+ */
+
+#ifndef ROSTER_STREAM_DECODER_H
+#define ROSTER_STREAM_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "protocol.h"
+
+/**
+ * \class RosterStreamDecoder
+ * \brief Push-based decoder for a serialized roster
+ *
+ * \details Bytes are fed as they arrive, records are pulled out as soon
+ * as they are complete. Only the bytes of a record that is still being
+ * received are kept, so memory does not grow with the roster size.
+ *
+ * Understands CharacterData::serializeVector() and
+ * CharacterData::serializeVectorCompact() payloads, pulled with next(),
+ * and CharacterColumns::serialize() payloads, pulled a row group at a
+ * time with nextGroup().
+ */
+class RosterStreamDecoder {
+public:
+    /**
+     * \brief Payload encodings
+     */
+    enum class Layout {
+        Plain,      ///< CharacterData::serializeVector()
+        Compact,    ///< CharacterData::serializeVectorCompact()
+        Columnar    ///< CharacterColumns::serialize()
+    };
+
+    /**
+     * \brief Constructs a decoder expecting the start of a payload
+     * \param layout Payload encoding
+     */
+    explicit RosterStreamDecoder(Layout layout);
+
+    /**
+     * \brief Limits the bytes held for records still being received
+     * \param bytes Limit, 0 for none
+     */
+    void setMaxBuffered(size_t bytes) { m_maxBuffered = bytes; }
+
+    /**
+     * \brief Appends received payload bytes
+     * \param data Bytes to append
+     * \param size Number of bytes
+     * \throws std::length_error if the undecoded bytes exceed setMaxBuffered()
+     *
+     * \note Decode what is complete with next() or nextGroup() before
+     * feeding more, the limit applies to everything not yet decoded
+     */
+    void feed(const uint8_t* data, size_t size);
+
+    /**
+     * \brief Decodes the next complete record
+     * \param character [out] Decoded record
+     * \return bool False if no complete record is buffered yet
+     */
+    bool next(CharacterData& character);
+
+    /**
+     * \brief Decodes the next complete row group of a columnar payload
+     * \param columns [out] Rows of the group
+     * \return bool False if no complete group is buffered yet
+     * \throws std::out_of_range if a complete group is malformed
+     */
+    bool nextGroup(CharacterColumns& columns);
+
+    /**
+     * \brief Returns whether every announced record was decoded
+     * \return bool True once the payload is fully consumed
+     */
+    bool atEnd() const;
+
+    /**
+     * \brief Returns the number of records decoded so far
+     * \return size_t Record count
+     */
+    size_t decoded() const { return m_decoded; }
+
+    /**
+     * \brief Returns the number of bytes buffered and not yet decoded
+     * \return size_t Byte count
+     */
+    size_t buffered() const { return m_buffer.size() - m_offset; }
+
+private:
+    /**
+     * \brief Reads the record count once enough bytes are buffered
+     * \return bool True if the count is known
+     */
+    bool readCount();
+
+    /**
+     * \brief Drops consumed bytes from the front of the buffer
+     */
+    void compact();
+
+    Layout m_layout;                  ///< Payload encoding
+    std::vector<uint8_t> m_buffer;    ///< Received, partly consumed bytes
+    size_t m_offset = 0;              ///< First byte not yet decoded
+    size_t m_maxBuffered = 0;         ///< Limit on undecoded bytes, 0 for none
+    bool m_haveCount = false;         ///< Record count has been read, or the last group for columnar
+    uint32_t m_count = 0;             ///< Records announced by the payload
+    uint32_t m_decoded = 0;           ///< Records decoded so far
+};
+
+#endif // ROSTER_STREAM_DECODER_H
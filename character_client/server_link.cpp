@@ -0,0 +1,732 @@
+#include "server_link.h"
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QTimer>
+
+ServerLink::ServerLink(Transport::Kind kind, const QString& host, quint16 port, QObject* parent)
+    : QObject(parent), m_kind(kind), m_host(host), m_port(port),
+      m_transport(Transport::create(kind, host, port, this)), m_reconnectTimer(new QTimer(this)),
+      m_handshakeTimer(new QTimer(this))
+{
+    connect(m_transport, &Transport::signalConnected, this, &ServerLink::slotConnected);
+    connect(m_transport, &Transport::signalDisconnected, this, &ServerLink::slotDisconnected);
+    connect(m_transport, &Transport::signalReadyRead, this, &ServerLink::slotReadyRead);
+    connect(m_transport, &Transport::signalError, this, &ServerLink::slotError);
+    // Bounded, so a client that falls behind pushes back on the server
+    m_transport->setReadBufferSize(DEFAULT_READ_BUFFER_SIZE);
+
+    m_reconnectTimer->setSingleShot(true);
+    connect(m_reconnectTimer, &QTimer::timeout, this, &ServerLink::slotReconnect);
+    m_handshakeTimer->setSingleShot(true);
+    connect(m_handshakeTimer, &QTimer::timeout, this, &ServerLink::slotHandshakeTimeout);
+    m_clock.start();
+}
+
+ServerLink::~ServerLink() {
+    m_open = false;
+    m_transport->disconnectFromServer();
+}
+
+void ServerLink::open() {
+    m_open = true;
+    slotReconnect();
+}
+
+void ServerLink::close() {
+    m_open = false;
+    m_reconnectTimer->stop();
+    m_handshakeTimer->stop();
+    m_transport->disconnectFromServer();
+}
+
+void ServerLink::slotReconnect() {
+    if (m_open && m_transport->state() == Transport::State::Unconnected) {
+        m_transport->connectToServer();
+    }
+}
+
+void ServerLink::scheduleReconnect() {
+    if (!m_open || m_reconnectTimer->isActive()) {
+        return;
+    }
+    m_reconnectTimer->start(m_reconnectDelayMs);
+    m_reconnectDelayMs = std::min(m_reconnectDelayMs * 2, RECONNECT_MAX_MS);
+}
+
+void ServerLink::sampleRtt(const Request& request) {
+    const qint64 now = m_clock.nsecsElapsed();
+    const double sample = static_cast<double>(now - request.sentAtNs) / 1e6;
+    m_rttMs = (m_lastRttSampleNs < 0) ? sample : m_rttMs + RTT_ALPHA * (sample - m_rttMs);
+    m_lastRttSampleNs = now;
+}
+
+qint64 ServerLink::msSinceRttSample() const {
+    if (m_lastRttSampleNs < 0) {
+        return -1;
+    }
+    return (m_clock.nsecsElapsed() - m_lastRttSampleNs) / 1000000;
+}
+
+std::vector<uint8_t> ServerLink::serializeId(int id) {
+    std::vector<uint8_t> data(sizeof(id));
+    std::memcpy(data.data(), &id, sizeof(id));
+    return data;
+}
+
+bool ServerLink::extractMessage(std::vector<uint8_t>& message)
+{
+    if (!m_buffer.next(message)) {
+        return false;
+    }
+    m_stats.largestFrame = std::max(m_stats.largestFrame, static_cast<uint32_t>(message.size()));
+    return true;
+}
+
+void ServerLink::completeHandshake(uint32_t features)
+{
+    m_handshakeTimer->stop();
+    m_features = features;
+    m_buffer.setFramed(features & Protocol::FEATURE_LENGTH_FRAMED);
+    m_ready = true;
+    m_reconnectDelayMs = RECONNECT_MIN_MS;
+    emit signalConnectionEstablished();
+}
+
+std::vector<uint8_t> ServerLink::encodeCharacter(const CharacterData& character) const {
+    if (m_features & Protocol::FEATURE_VARINT_ENCODING) {
+        return character.serializeCompact();
+    }
+    return character.serialize();
+}
+
+CharacterData ServerLink::decodeCharacter(const std::vector<uint8_t>& data) const {
+    if (m_features & Protocol::FEATURE_VARINT_ENCODING) {
+        return CharacterData::deserializeCompact(data);
+    }
+    return CharacterData::deserialize(data);
+}
+
+std::vector<CharacterData> ServerLink::decodeCharacters(const std::vector<uint8_t>& data) const {
+    if (m_features & Protocol::FEATURE_VARINT_ENCODING) {
+        return CharacterData::deserializeVectorCompact(data);
+    }
+    return CharacterData::deserializeVector(data);
+}
+
+std::vector<uint8_t> ServerLink::projectionPayload(uint8_t fields, uint16_t bioPreviewLength) const {
+    std::vector<uint8_t> projection;
+    // Old servers do not expect a payload, a full fetch needs none either
+    if ((m_features & Protocol::FEATURE_PROJECTION)
+            && (fields != Protocol::FIELD_ALL || bioPreviewLength != 0)) {
+        projection.resize(sizeof(fields) + sizeof(bioPreviewLength));
+        projection[0] = fields;
+        std::memcpy(projection.data() + sizeof(fields), &bioPreviewLength, sizeof(bioPreviewLength));
+    }
+    return projection;
+}
+
+void ServerLink::getAllCharacters(uint8_t fields, uint16_t bioPreviewLength, int ticket) {
+    Request request{
+        (m_features & Protocol::FEATURE_COLUMNAR) ? Protocol::GET_ALL_COLUMNAR : Protocol::GET_ALL
+    };
+    request.ticket = ticket;
+    request.fields = fields;
+    request.bioPreviewLength = bioPreviewLength;
+    sendRequest(request, projectionPayload(fields, bioPreviewLength));
+}
+
+void ServerLink::streamAllCharacters(int streamId, uint8_t fields, uint16_t bioPreviewLength) {
+    if (!m_ready) {
+        emit signalStreamFinished(streamId, false, "Not connected to server");
+        return;
+    }
+
+    Request request{
+        (m_features & Protocol::FEATURE_COLUMNAR) ? Protocol::GET_ALL_COLUMNAR : Protocol::GET_ALL
+    };
+    request.streamId = streamId;
+    request.ticket = streamId;
+    request.fields = fields;
+    request.bioPreviewLength = bioPreviewLength;
+    sendRequest(request, projectionPayload(fields, bioPreviewLength));
+}
+
+void ServerLink::streamQuery(int streamId, const CharacterQuery& query, uint8_t fields, uint16_t bioPreviewLength) {
+    if (!m_ready) {
+        emit signalStreamFinished(streamId, false, "Not connected to server");
+        return;
+    }
+
+    Request request{Protocol::QUERY};
+    request.streamId = streamId;
+    request.ticket = streamId;
+    request.fields = fields;
+    request.bioPreviewLength = bioPreviewLength;
+    request.query = query;
+
+    // Unlike GET_ALL the projection is always present, the query follows it
+    std::vector<uint8_t> data(sizeof(fields) + sizeof(bioPreviewLength));
+    data[0] = fields;
+    std::memcpy(data.data() + sizeof(fields), &bioPreviewLength, sizeof(bioPreviewLength));
+    query.write(data);
+    sendRequest(request, data);
+}
+
+std::unique_ptr<RosterStreamDecoder> ServerLink::makeStreamDecoder(uint8_t command) const {
+    if (command == Protocol::GET_ALL_COLUMNAR) {
+        return std::make_unique<RosterStreamDecoder>(RosterStreamDecoder::Layout::Columnar);
+    }
+    return std::make_unique<RosterStreamDecoder>(
+                (m_features & Protocol::FEATURE_VARINT_ENCODING)
+                ? RosterStreamDecoder::Layout::Compact
+                : RosterStreamDecoder::Layout::Plain
+                );
+}
+
+bool ServerLink::beginStream() {
+    if (!(m_features & Protocol::FEATURE_LENGTH_FRAMED)
+            || m_pending.empty() || m_pending.front().streamId == 0) {
+        return false;
+    }
+
+    uint32_t length = 0;
+    if (m_buffer.size() < sizeof(length) + 1) {
+        return false;
+    }
+    std::memcpy(&length, m_buffer.data(), sizeof(length));
+    const uint8_t command = m_pending.front().command;
+    // Errors and notifications take the usual path
+    if (length == 0 || m_buffer.data()[sizeof(length)] != command) {
+        return false;
+    }
+
+    const Request request = m_pending.front();
+    m_pending.pop_front();
+    m_stream.id = request.streamId;
+    m_stream.remaining = length - 1;
+    m_stream.columnar = command == Protocol::GET_ALL_COLUMNAR;
+    m_buffer.consume(sizeof(length) + 1);
+    // A cancelled stream keeps no decoder, its payload is skipped
+    if (request.cancelled) {
+        if (m_stream.remaining == 0) {
+            m_stream = RosterStream();
+        }
+        return true;
+    }
+
+    emit signalRequestAnswered(request.ticket);
+    m_stream.decoder = makeStreamDecoder(command);
+    m_stream.decoder->setMaxBuffered(m_buffer.maxFrameSize());
+    if (m_stream.remaining == 0) {
+        // Empty database
+        emit signalStreamFinished(m_stream.id, true, QString());
+        m_stream = RosterStream();
+    }
+    return true;
+}
+
+bool ServerLink::continueStream() {
+    size_t size = std::min<size_t>(m_stream.remaining, m_buffer.size());
+    if (size == 0) {
+        return false;
+    }
+
+    m_stream.remaining -= static_cast<uint32_t>(size);
+    feedStream(m_buffer.data(), size);
+    m_buffer.consume(size);
+    if (m_stream.remaining == 0) {
+        endStream();
+    }
+    return true;
+}
+
+void ServerLink::feedStream(const uint8_t* data, size_t size) {
+    if (!m_stream.decoder) {
+        return;
+    }
+
+    try {
+        m_stream.decoder->feed(data, size);
+        if (m_stream.columnar) {
+            CharacterColumns group;
+            while (m_stream.decoder->nextGroup(group)) {
+                emit signalColumnsChunk(m_stream.id, group);
+            }
+            return;
+        }
+
+        std::vector<CharacterData> chunk;
+        CharacterData character;
+        while (m_stream.decoder->next(character)) {
+            chunk.push_back(std::move(character));
+            if (chunk.size() == STREAM_CHUNK_RECORDS) {
+                emit signalCharactersChunk(m_stream.id, chunk);
+                chunk.clear();
+            }
+        }
+        if (!chunk.empty()) {
+            emit signalCharactersChunk(m_stream.id, chunk);
+        }
+    } catch (const std::exception& e) {
+        emit signalStreamFinished(m_stream.id, false, QString("Processing error: %1").arg(e.what()));
+        m_stream.decoder.reset();
+    }
+}
+
+void ServerLink::endStream() {
+    // A failed stream has already been reported
+    if (m_stream.decoder) {
+        if (m_stream.decoder->atEnd()) {
+            emit signalStreamFinished(m_stream.id, true, QString());
+        } else {
+            emit signalStreamFinished(m_stream.id, false, "Truncated roster");
+        }
+    }
+    m_stream = RosterStream();
+}
+
+void ServerLink::getCharacter(int id, bool background, int ticket) {
+    Request request{Protocol::GET_ONE, id, background};
+    request.ticket = ticket;
+    sendRequest(request, serializeId(id));
+}
+
+void ServerLink::getStats(uint8_t surnameLimit, int ticket) {
+    Request request{Protocol::STATS};
+    request.ticket = ticket;
+    request.surnameLimit = surnameLimit;
+    sendRequest(request, {surnameLimit});
+}
+
+void ServerLink::resend(const Request& request) {
+    switch (request.command) {
+    case Protocol::GET_ONE:
+        getCharacter(request.id, request.background, request.ticket);
+        break;
+    case Protocol::GET_ALL:
+    case Protocol::GET_ALL_COLUMNAR:
+        // This server may have negotiated other features, the request is rebuilt
+        if (request.streamId != 0) {
+            streamAllCharacters(request.streamId, request.fields, request.bioPreviewLength);
+        } else {
+            getAllCharacters(request.fields, request.bioPreviewLength, request.ticket);
+        }
+        break;
+    case Protocol::QUERY:
+        streamQuery(request.streamId, request.query, request.fields, request.bioPreviewLength);
+        break;
+    case Protocol::STATS:
+        getStats(request.surnameLimit, request.ticket);
+        break;
+    default:
+        // Mutations are never resent, they may have been applied
+        break;
+    }
+}
+
+bool ServerLink::cancel(int ticket) {
+    if (ticket == 0) {
+        return false;
+    }
+    // The rest of a stream already under way is skipped
+    if (m_stream.id == ticket) {
+        m_stream.decoder.reset();
+        return true;
+    }
+    // Answers arrive in order, a cancelled request still takes its answer
+    for (auto& request : m_pending) {
+        if (request.ticket == ticket && !request.cancelled) {
+            request.cancelled = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ServerLink::restart(const QString& reason) {
+    if (m_transport->state() == Transport::State::Unconnected) {
+        return;
+    }
+    emit signalConnectionFailed(reason);
+    // Emits disconnected, which hands the pending requests back
+    m_transport->abort();
+}
+
+qint64 ServerLink::msSinceActivity() const {
+    return (m_clock.nsecsElapsed() - m_lastActivityNs) / 1000000;
+}
+
+void ServerLink::subscribeToChanges(int ticket) {
+    Request request{Protocol::SUBSCRIBE};
+    request.ticket = ticket;
+    sendRequest(request);
+}
+
+void ServerLink::removeCharacter(int id, int ticket) {
+    Request request{Protocol::REMOVE_CHARACTER, id};
+    request.ticket = ticket;
+    sendRequest(request, serializeId(id));
+}
+
+void ServerLink::updateCharacter(const CharacterData& character, int ticket) {
+    Request request{Protocol::UPDATE_CHARACTER, character.id};
+    request.ticket = ticket;
+    sendRequest(request, encodeCharacter(character));
+}
+
+void ServerLink::addCharacter(const CharacterData& character, int ticket, uint32_t batchSize) {
+    Request request{Protocol::ADD_CHARACTER};
+    request.ticket = ticket;
+    request.batchSize = batchSize;
+    sendRequest(request, encodeCharacter(character));
+}
+
+void ServerLink::addCharacters(const std::vector<CharacterData>& characters, int ticket) {
+    if (characters.empty()) {
+        return;
+    }
+
+    std::vector<uint8_t> data = (m_features & Protocol::FEATURE_VARINT_ENCODING)
+            ? CharacterData::serializeVectorCompact(characters)
+            : CharacterData::serializeVector(characters);
+    Request request{Protocol::ADD_CHARACTERS};
+    request.ticket = ticket;
+    request.batchSize = static_cast<uint32_t>(characters.size());
+    sendRequest(request, data);
+}
+
+void ServerLink::sendRequest(Request request, const std::vector<uint8_t>& data) {
+    const uint8_t command = request.command;
+    if (m_transport->state() != Transport::State::Connected) {
+        emit signalOperationCompleted(false, "Not connected to server");
+        return;
+    }
+
+    // Prepend command byte
+    std::vector<uint8_t> packet;
+    const bool framed = m_features & Protocol::FEATURE_LENGTH_FRAMED;
+    // 1 for command
+    packet.reserve(sizeof(uint32_t) + 1 + data.size() + Protocol::MESSAGE_DELIMITER_SIZE);
+    if (framed) {
+        uint32_t length = static_cast<uint32_t>(1 + data.size());
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&length);
+        packet.insert(packet.end(), bytes, bytes + sizeof(length));
+    }
+    packet.push_back(command);
+    packet.insert(packet.end(), data.begin(), data.end());
+
+    if (!framed) {
+        packet.insert(packet.end(), Protocol::MESSAGE_DELIMITER.begin(), Protocol::MESSAGE_DELIMITER.end());
+    }
+
+    m_transport->write(reinterpret_cast<const char*>(packet.data()), static_cast<qint64>(packet.size()));
+    m_transport->flush();
+    request.sentAtNs = m_clock.nsecsElapsed();
+    m_pending.push_back(request);
+}
+
+void ServerLink::slotConnected() {
+    m_ready = false;
+    m_lastActivityNs = m_clock.nsecsElapsed();
+    m_features = 0;
+    m_buffer.clear();
+    m_pending.clear();
+    m_stream = RosterStream();
+    m_readPaused = false;
+    m_stats = BufferStats();
+
+    // Offer everything we support, the server picks
+    uint32_t offered = SUPPORTED_FEATURES;
+    std::vector<uint8_t> data(sizeof(offered));
+    std::memcpy(data.data(), &offered, sizeof(offered));
+    sendRequest({Protocol::HELLO}, data);
+    // The owner sends nothing before the link is ready, so nothing else times it
+    m_handshakeTimer->start(static_cast<int>(Protocol::READ_TIMEOUT));
+}
+
+void ServerLink::slotHandshakeTimeout() {
+    // Accepted the connection and never answered, neither protocol works
+    if (!m_ready) {
+        restart("Server did not answer the handshake");
+    }
+}
+
+void ServerLink::slotDisconnected() {
+    m_handshakeTimer->stop();
+    m_ready = false;
+    m_subscribed = false;
+    m_features = 0;
+
+    // Chunks were delivered already, resending would duplicate them
+    if (m_stream.id != 0 && m_stream.decoder) {
+        emit signalStreamFinished(m_stream.id, false, "Disconnected from server");
+    }
+    m_stream = RosterStream();
+
+    // The handshake is the link's own, everything else goes to the owner
+    std::vector<Request> lost;
+    lost.reserve(m_pending.size());
+    for (const auto& request : m_pending) {
+        if (request.command != Protocol::HELLO && !request.cancelled) {
+            lost.push_back(request);
+        }
+    }
+    m_pending.clear();
+
+    emit signalDisconnected(lost);
+    scheduleReconnect();
+}
+
+void ServerLink::resumeReading() {
+    if (!m_readPaused) {
+        return;
+    }
+    m_readPaused = false;
+    // Data already in the socket does not emit readyRead again
+    QTimer::singleShot(0, this, &ServerLink::slotReadyRead);
+}
+
+void ServerLink::slotReadyRead() {
+    QElapsedTimer budget;
+    budget.start();
+
+    // Bounded reads, a large roster is decoded while the rest still arrives
+    while (!m_readPaused && m_transport->bytesAvailable() > 0) {
+        m_stats.socketHighWater = std::max(m_stats.socketHighWater, m_transport->bytesAvailable());
+        QByteArray newData = m_transport->read(READ_CHUNK_SIZE);
+        m_stats.bytesReceived += static_cast<uint64_t>(newData.size());
+        m_lastActivityNs = m_clock.nsecsElapsed();
+        m_buffer.append(newData.constData(), static_cast<size_t>(newData.size()));
+        m_stats.bufferHighWater = std::max(m_stats.bufferHighWater, m_buffer.size());
+
+        if (!processBuffer()) {
+            return;
+        }
+
+        // Let the UI paint, the socket buffer holds the rest meanwhile
+        if (m_transport->bytesAvailable() > 0 && budget.elapsed() >= READ_BUDGET_MS) {
+            ++m_stats.yields;
+            QTimer::singleShot(0, this, &ServerLink::slotReadyRead);
+            return;
+        }
+    }
+    if (m_readPaused && m_transport->bytesAvailable() > 0) {
+        ++m_stats.yields;
+    }
+}
+
+bool ServerLink::processBuffer() {
+    std::vector<uint8_t> message;
+
+    // taking into account TCP messages framing and stacking,
+    // framing is re-checked per message as HELLO may switch it
+    try {
+        while (m_transport->state() == Transport::State::Connected) {
+            // Streamed rosters are consumed as they arrive, never buffered whole
+            if (m_stream.id != 0) {
+                if (!continueStream()) {
+                    break;
+                }
+                continue;
+            }
+            if (beginStream()) {
+                continue;
+            }
+            if (!extractMessage(message)) {
+                break;
+            }
+            processResponse(message);
+        }
+    } catch (const std::length_error& e) {
+        failProtocol(e.what());
+        return false;
+    }
+    return m_transport->state() == Transport::State::Connected;
+}
+
+void ServerLink::failProtocol(const QString& message) {
+    m_buffer.clear();
+    emit signalConnectionFailed("Protocol error: " + message);
+    // Emits disconnected, which fails everything still pending
+    m_transport->abort();
+}
+
+void ServerLink::processResponse(const std::vector<uint8_t>& data) {
+    if (data.empty()) {
+        emit signalOperationCompleted(false, "Empty response from server");
+        return;
+    }
+
+    uint8_t responseType = data[0];
+    std::vector<uint8_t> payload(data.begin() + 1, data.end());
+
+    // The server answers requests in order, notifications are the only
+    // messages that do not consume a pending request
+    Request request;
+    if (responseType != Protocol::NOTIFY_CHANGED && responseType != Protocol::NOTIFY_REMOVED
+            && !m_pending.empty()) {
+        request = m_pending.front();
+        m_pending.pop_front();
+        // Roster transfers would measure bandwidth, not latency
+        if (request.streamId == 0 && request.command != Protocol::GET_ALL
+                && request.command != Protocol::GET_ALL_COLUMNAR
+                && request.command != Protocol::QUERY
+                && request.command != Protocol::ADD_CHARACTERS) {
+            sampleRtt(request);
+        }
+        // Its owner has given up on it already
+        if (request.cancelled) {
+            return;
+        }
+        if (request.ticket != 0) {
+            emit signalRequestAnswered(request.ticket);
+        }
+    }
+
+    if (responseType == Protocol::RESP_ERROR) {
+        // Servers predating HELLO reject it, talk the original protocol
+        if (request.command == Protocol::HELLO) {
+            completeHandshake(0);
+            return;
+        }
+        // Servers without push support reject the subscription, keep polling
+        if (request.command == Protocol::SUBSCRIBE) {
+            m_subscribed = false;
+            emit signalSubscriptionChanged(false);
+            return;
+        }
+        if (request.batchSize != 0) {
+            emit signalBatchCompleted(0, request.batchSize);
+            return;
+        }
+        if (request.streamId != 0) {
+            emit signalStreamFinished(request.streamId, false, "Server returned error");
+            return;
+        }
+        if (request.command == Protocol::STATS) {
+            emit signalStatsFailed("Server returned error");
+            return;
+        }
+        // Nobody is waiting on a background request, just let its owner know
+        if (request.background) {
+            emit signalPrefetchFailed(request.id);
+            return;
+        }
+        emit signalOperationCompleted(false, "Server returned error");
+        return;
+    }
+
+    try {
+        switch (responseType) {
+        case Protocol::HELLO:
+            completeHandshake(Protocol::acceptedFeatures(data, SUPPORTED_FEATURES));
+            break;
+
+        case Protocol::GET_ALL:
+        case Protocol::QUERY:
+            // Delimited framing, the payload is already complete
+            if (request.streamId != 0) {
+                m_stream.id = request.streamId;
+                m_stream.decoder = makeStreamDecoder(responseType);
+                m_stream.decoder->setMaxBuffered(m_buffer.maxFrameSize());
+                if (payload.empty()) {
+                    emit signalStreamFinished(m_stream.id, true, QString());
+                    m_stream = RosterStream();
+                    break;
+                }
+                feedStream(payload.data(), payload.size());
+                endStream();
+                break;
+            }
+            if (payload.size() == 0) {
+                emit signalOperationCompleted(false, "Empty db");
+                break;
+            }
+            emit signalCharactersReceived(decodeCharacters(payload));
+            break;
+
+        case Protocol::GET_ALL_COLUMNAR:
+            emit signalColumnsReceived(CharacterColumns::deserialize(payload));
+            break;
+
+        case Protocol::GET_ONE:
+            if (request.background) {
+                emit signalCharacterPrefetched(decodeCharacter(payload));
+                break;
+            }
+            emit signalCharacterReceived(decodeCharacter(payload));
+            break;
+
+        case Protocol::STATS:
+            emit signalStatsReceived(CharacterStats::deserialize(payload));
+            break;
+
+        case Protocol::ADD_CHARACTER:
+            if (request.batchSize != 0) {
+                emit signalBatchCompleted(request.batchSize, 0);
+                break;
+            }
+            emit signalOperationCompleted(true, "Add successful");
+            break;
+        case Protocol::ADD_CHARACTERS: {
+            uint32_t added = 0;
+            if (payload.size() >= sizeof(added)) {
+                std::memcpy(&added, payload.data(), sizeof(added));
+            }
+            added = std::min(added, request.batchSize);
+            emit signalBatchCompleted(added, request.batchSize - added);
+            break;
+        }
+        case Protocol::UPDATE_CHARACTER:
+            emit signalOperationCompleted(true, "Update successful");
+            break;
+        case Protocol::REMOVE_CHARACTER:
+            emit signalOperationCompleted(true, "Remove successful");
+            break;
+
+        case Protocol::SUBSCRIBE:
+            m_subscribed = true;
+            emit signalSubscriptionChanged(true);
+            break;
+
+        // Unsolicited, may arrive between any request and its response
+        case Protocol::NOTIFY_CHANGED:
+            emit signalCharactersChanged(decodeCharacters(payload));
+            break;
+        case Protocol::NOTIFY_REMOVED:
+            emit signalCharactersRemoved(CharacterData::deserializeIds(payload));
+            break;
+
+        case Protocol::RESP_SUCCESS:
+            emit signalOperationCompleted(true, "Operation successful");
+            break;
+
+        default:
+            emit signalOperationCompleted(false, "Unknown response type");
+        }
+    } catch (const std::exception& e) {
+        const QString message = QString("Processing error: %1").arg(e.what());
+        if (request.command == Protocol::STATS) {
+            emit signalStatsFailed(message);
+            return;
+        }
+        // As for an error answer, the prefetcher frees the slot and nobody sees a dialog
+        if (request.background) {
+            emit signalPrefetchFailed(request.id);
+            return;
+        }
+        emit signalOperationCompleted(false, message);
+    }
+}
+
+void ServerLink::slotError(const QString& message) {
+    emit signalConnectionFailed(message);
+    // Failed attempts never emit disconnected
+    if (m_transport->state() != Transport::State::Connected) {
+        scheduleReconnect();
+    }
+}
@@ -0,0 +1,576 @@
+#ifndef SERVER_LINK_H
+#define SERVER_LINK_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+#include <deque>
+#include <memory>
+#include <vector>
+#include "frame_buffer.h"
+#include "protocol.h"
+#include "roster_stream_decoder.h"
+#include "transport.h"
+
+/**
+ * \class ServerLink
+ * \brief Handles communication with one character server
+ * \ingroup Network
+ *
+ * \details Manages the client side of a single server connection:
+ * - Connection establishment, feature negotiation and reconnects
+ * - Request/response handling
+ * - Character data serialization
+ * - Round-trip time tracking
+ *
+ * The bytes travel over a Transport chosen per endpoint. ClientConnection
+ * routes requests over one ServerLink per endpoint.
+ */
+class ServerLink : public QObject {
+    Q_OBJECT
+
+public:
+    /**
+     * \struct BufferStats
+     * \brief Receive-side memory counters
+     */
+    struct BufferStats {
+        size_t bufferHighWater = 0;     ///< Largest receive buffer seen, in bytes
+        qint64 socketHighWater = 0;     ///< Most bytes waiting in the socket at a read
+        uint32_t largestFrame = 0;      ///< Largest buffered message, in bytes
+        uint64_t bytesReceived = 0;     ///< Bytes read from the socket
+        uint32_t yields = 0;            ///< Times reading stopped with data still waiting
+    };
+
+    /**
+     * \struct Request
+     * \brief Request sent to the server and not answered yet
+     */
+    struct Request {
+        uint8_t command = 0;        ///< Protocol command byte
+        int32_t id = 0;             ///< Character ID the request refers to, if any
+        bool background = false;    ///< Failures are not reported to the user
+        uint32_t batchSize = 0;     ///< Records of addCharacters() acknowledged by the response
+        int streamId = 0;           ///< Roster stream the response feeds, if any
+        uint8_t fields = Protocol::FIELD_ALL;   ///< GET_ALL projection, kept for resending
+        uint16_t bioPreviewLength = 0;          ///< GET_ALL bio preview, kept for resending
+        uint8_t surnameLimit = 0;               ///< STATS surname limit, kept for resending
+        CharacterQuery query{};                 ///< QUERY predicate, kept for resending
+        qint64 sentAtNs = 0;        ///< Send time on the link clock
+        int ticket = 0;             ///< Owner's request ID, 0 if untracked
+        bool cancelled = false;     ///< Answer is discarded on arrival
+    };
+
+    /**
+     * \brief Constructs a link, call open() to connect
+     * \param kind Transport to the server
+     * \param host Server hostname/IP address, or the socket name for local transports
+     * \param port Server port, TCP only
+     * \param parent Optional QObject parent
+     */
+    ServerLink(Transport::Kind kind, const QString& host, quint16 port, QObject* parent = nullptr);
+
+    /**
+     * \brief Destructor - ensures proper socket cleanup
+     */
+    ~ServerLink();
+
+    /**
+     * \brief Returns the transport to the server
+     * \return Transport::Kind Backend in use
+     */
+    Transport::Kind transportKind() const { return m_kind; }
+
+    /**
+     * \brief Returns the server hostname/IP address
+     * \return const QString& Host, or the socket name for local transports
+     */
+    const QString& host() const { return m_host; }
+
+    /**
+     * \brief Returns the server port
+     * \return quint16 Port
+     */
+    quint16 port() const { return m_port; }
+
+    /**
+     * \brief Connects, and keeps reconnecting with backoff until close()
+     *
+     * \note Emits signalConnectionEstablished() after each successful
+     * negotiation, signalConnectionFailed() on each failed attempt. A
+     * server not answering HELLO within Protocol::READ_TIMEOUT counts as
+     * a failed attempt
+     */
+    void open();
+
+    /**
+     * \brief Disconnects and stops reconnecting
+     */
+    void close();
+
+    /**
+     * \brief Returns whether the link is connected and negotiated
+     * \return bool True if requests can be sent
+     */
+    bool isReady() const { return m_ready; }
+
+    /**
+     * \brief Returns the smoothed round-trip time
+     * \return double Exponentially weighted moving average in milliseconds
+     *
+     * \note Sampled from small requests only, roster transfers would
+     * measure bandwidth instead of latency
+     */
+    double rttMs() const { return m_rttMs; }
+
+    /**
+     * \brief Returns the time since the last round-trip sample
+     * \return qint64 Milliseconds, -1 if there has been none
+     */
+    qint64 msSinceRttSample() const;
+
+    /**
+     * \brief Requests all characters
+     * \param fields Mask of Protocol::FIELD_* flags to load
+     * \param bioPreviewLength Bio truncation in bytes, 0 for whole bios
+     * \param ticket Owner's request ID
+     * \see ClientConnection::getAllCharacters()
+     */
+    void getAllCharacters(uint8_t fields, uint16_t bioPreviewLength, int ticket = 0);
+
+    /**
+     * \brief Requests all characters, decoded while they arrive
+     * \param streamId Stream ID carried by the stream signals, also its ticket
+     * \param fields Mask of Protocol::FIELD_* flags to load
+     * \param bioPreviewLength Bio truncation in bytes, 0 for whole bios
+     * \see ClientConnection::streamAllCharacters()
+     */
+    void streamAllCharacters(int streamId, uint8_t fields, uint16_t bioPreviewLength);
+
+    /**
+     * \brief Requests the characters matching a query, decoded while they arrive
+     * \param streamId Stream ID carried by the stream signals, also its ticket
+     * \param query Predicate evaluated by the server
+     * \param fields Mask of Protocol::FIELD_* flags to load
+     * \param bioPreviewLength Bio truncation in bytes, 0 for whole bios
+     * \see ClientConnection::streamQuery()
+     *
+     * \note Requires Protocol::FEATURE_QUERY
+     */
+    void streamQuery(int streamId, const CharacterQuery& query, uint8_t fields, uint16_t bioPreviewLength);
+
+    /**
+     * \brief Requests single character by ID
+     * \param id Character ID to retrieve
+     * \param background Answer with signalCharacterPrefetched() or
+     * signalPrefetchFailed() instead
+     * \param ticket Owner's request ID
+     */
+    void getCharacter(int id, bool background = false, int ticket = 0);
+
+    /**
+     * \brief Requests roster aggregates
+     * \param surnameLimit Most frequent surnames to include
+     * \param ticket Owner's request ID
+     * \see ClientConnection::getStats()
+     *
+     * \note Requires Protocol::FEATURE_STATS
+     */
+    void getStats(uint8_t surnameLimit, int ticket = 0);
+
+    /**
+     * \brief Adds new character to server
+     * \param character Character data to add
+     * \param ticket Owner's request ID
+     * \param batchSize Report the answer through signalBatchCompleted()
+     * as a batch of one if 1
+     */
+    void addCharacter(const CharacterData& character, int ticket = 0, uint32_t batchSize = 0);
+
+    /**
+     * \brief Adds several characters to server in one request
+     * \param characters Characters to add
+     * \param ticket Owner's request ID
+     * \see ClientConnection::addCharacters()
+     *
+     * \note Requires Protocol::FEATURE_BATCH_ADD
+     */
+    void addCharacters(const std::vector<CharacterData>& characters, int ticket = 0);
+
+    /**
+     * \brief Updates existing character on server
+     * \param character Modified character data
+     * \param ticket Owner's request ID
+     */
+    void updateCharacter(const CharacterData& character, int ticket = 0);
+
+    /**
+     * \brief Removes character from server
+     * \param id Character ID to remove
+     * \param ticket Owner's request ID
+     */
+    void removeCharacter(int id, int ticket = 0);
+
+    /**
+     * \brief Subscribes to server-pushed change notifications
+     * \param ticket Owner's request ID
+     */
+    void subscribeToChanges(int ticket = 0);
+
+    /**
+     * \brief Sends a read lost with another link again
+     * \param request Request from signalDisconnected()
+     *
+     * \note Mutations are ignored, they may have been applied already
+     */
+    void resend(const Request& request);
+
+    /**
+     * \brief Discards the answer to a request
+     * \param ticket Owner's request ID
+     * \return bool True if the request was pending on this link
+     *
+     * \note The server still answers, the answer is dropped on arrival.
+     * No signal is emitted for a cancelled request
+     */
+    bool cancel(int ticket);
+
+    /**
+     * \brief Drops the connection and reconnects
+     * \param reason Reported through signalConnectionFailed()
+     *
+     * \note For servers that stopped answering, pending requests are
+     * handed back through signalDisconnected()
+     */
+    void restart(const QString& reason);
+
+    /**
+     * \brief Returns the time since data was last received
+     * \return qint64 Milliseconds since the last read or connect
+     */
+    qint64 msSinceActivity() const;
+
+    /**
+     * \brief Returns whether change notifications are active
+     * \return bool True if the server accepted the subscription
+     */
+    bool isSubscribed() const { return m_subscribed; }
+
+    /**
+     * \brief Returns protocol features negotiated with the server
+     * \return uint32_t Mask of Protocol::FEATURE_* flags
+     */
+    uint32_t features() const { return m_features; }
+
+    /**
+     * \brief Limits the size of messages held in the receive buffer
+     * \param bytes Largest accepted message, length prefix excluded
+     * \see ClientConnection::setMaxFrameSize()
+     */
+    void setMaxFrameSize(uint32_t bytes) { m_buffer.setMaxFrameSize(bytes); }
+
+    /**
+     * \brief Limits the bytes the socket reads ahead of the client
+     * \param bytes Socket read buffer size, 0 for unlimited
+     */
+    void setReadBufferSize(qint64 bytes) { m_transport->setReadBufferSize(bytes); }
+
+    /**
+     * \brief Stops processing received data until resumeReading()
+     */
+    void pauseReading() { m_readPaused = true; }
+
+    /**
+     * \brief Resumes processing received data
+     */
+    void resumeReading();
+
+    /**
+     * \brief Returns receive-side memory counters
+     * \return const BufferStats& Counters since connect or resetBufferStats()
+     */
+    const BufferStats& bufferStats() const { return m_stats; }
+
+    /**
+     * \brief Resets receive-side memory counters
+     */
+    void resetBufferStats() { m_stats = BufferStats(); }
+
+    /// Default for setMaxFrameSize()
+    static constexpr uint32_t DEFAULT_MAX_FRAME_SIZE = 256u * 1024 * 1024;
+    /// Default for setReadBufferSize()
+    static constexpr qint64 DEFAULT_READ_BUFFER_SIZE = 4 * 1024 * 1024;
+
+signals:
+    /**
+     * \brief Emitted when the link is connected and negotiated
+     */
+    void signalConnectionEstablished();
+
+    /**
+     * \brief Emitted when a connection attempt or the connection fails
+     * \param error Error description
+     */
+    void signalConnectionFailed(const QString& error);
+
+    /**
+     * \brief Emitted when an established connection is lost
+     * \param lost Requests that were sent and never answered, oldest first
+     *
+     * \note A roster stream that already delivered chunks is failed
+     * through signalStreamFinished() and is not part of lost
+     */
+    void signalDisconnected(const std::vector<ServerLink::Request>& lost);
+
+    /**
+     * \brief Emitted when the answer to a tracked request starts arriving
+     * \param ticket Owner's request ID
+     *
+     * \note Emitted before the answer's own signal, for streams before
+     * the first chunk
+     */
+    void signalRequestAnswered(int ticket);
+
+    /// \see ClientConnection::signalCharactersReceived()
+    void signalCharactersReceived(const std::vector<CharacterData>& characters);
+    /// \see ClientConnection::signalColumnsReceived()
+    void signalColumnsReceived(const CharacterColumns& columns);
+    /// \see ClientConnection::signalCharactersChunk()
+    void signalCharactersChunk(int streamId, const std::vector<CharacterData>& characters);
+    /// \see ClientConnection::signalColumnsChunk()
+    void signalColumnsChunk(int streamId, const CharacterColumns& columns);
+    /// \see ClientConnection::signalStreamFinished()
+    void signalStreamFinished(int streamId, bool success, const QString& message);
+    /// \see ClientConnection::signalCharacterReceived()
+    void signalCharacterReceived(const CharacterData& character);
+    /// \see ClientConnection::signalCharacterPrefetched()
+    void signalCharacterPrefetched(const CharacterData& character);
+    /// \see ClientConnection::signalPrefetchFailed()
+    void signalPrefetchFailed(int id);
+    /// \see ClientConnection::signalStatsReceived()
+    void signalStatsReceived(const CharacterStats& stats);
+    /// \see ClientConnection::signalStatsFailed()
+    void signalStatsFailed(const QString& message);
+    /// \see ClientConnection::signalBatchCompleted()
+    void signalBatchCompleted(quint32 added, quint32 rejected);
+    /// \see ClientConnection::signalSubscriptionChanged()
+    void signalSubscriptionChanged(bool active);
+    /// \see ClientConnection::signalCharactersChanged()
+    void signalCharactersChanged(const std::vector<CharacterData>& characters);
+    /// \see ClientConnection::signalCharactersRemoved()
+    void signalCharactersRemoved(const std::vector<int32_t>& ids);
+    /// \see ClientConnection::signalOperationCompleted()
+    void signalOperationCompleted(bool success, const QString& message);
+
+private slots:
+    /**
+     * \brief Handles successful connection
+     */
+    void slotConnected();
+
+    /**
+     * \brief Handles server disconnection
+     */
+    void slotDisconnected();
+
+    /**
+     * \brief Processes incoming data from server
+     */
+    void slotReadyRead();
+
+    /**
+     * \brief Handles transport errors
+     * \param message Error description
+     */
+    void slotError(const QString& message);
+
+    /**
+     * \brief Starts a connection attempt if the link is still open
+     */
+    void slotReconnect();
+
+    /**
+     * \brief Drops a connection whose server never answered HELLO
+     *
+     * \note Reconnects with backoff, like any failed attempt
+     */
+    void slotHandshakeTimeout();
+
+private:
+    /**
+     * \struct RosterStream
+     * \brief GET_ALL response being decoded while it arrives
+     */
+    struct RosterStream {
+        int id = 0;                                      ///< Stream ID, 0 when idle
+        bool columnar = false;                           ///< Payload is CharacterColumns row groups
+        uint32_t remaining = 0;                          ///< Payload bytes still to arrive
+        std::unique_ptr<RosterStreamDecoder> decoder;    ///< Null once failed, the rest is skipped
+    };
+
+    /**
+     * \brief Sends request to server
+     * \param request Request to send, tracked until answered
+     * \param data Optional request payload
+     */
+    void sendRequest(Request request, const std::vector<uint8_t>& data = {});
+
+    /**
+     * \brief Schedules the next connection attempt with exponential backoff
+     */
+    void scheduleReconnect();
+
+    /**
+     * \brief Folds a round-trip sample into the moving average
+     * \param request Answered request
+     */
+    void sampleRtt(const Request& request);
+
+    /**
+     * \brief Processes every complete message in the receive buffer
+     * \return bool False if the connection was dropped
+     */
+    bool processBuffer();
+
+    /**
+     * \brief Drops the connection after a protocol violation
+     * \param message Error description
+     */
+    void failProtocol(const QString& message);
+
+    /**
+     * \brief Processes server response
+     * \param data Received binary data
+     */
+    void processResponse(const std::vector<uint8_t>& data);
+
+    /**
+     * \brief Serializes ID for network transmission
+     * \param id ID to serialize
+     * \return std::vector<uint8_t> 4-byte big-endian representation
+     */
+    std::vector<uint8_t> serializeId(int id);
+
+    /**
+     * \brief Extracts next complete message from buffer
+     * \param message [out] Message without framing
+     * \return bool True if a complete message was extracted
+     * \throws std::length_error if the message exceeds the frame size limit
+     *
+     * \details Uses the length prefix when Protocol::FEATURE_LENGTH_FRAMED
+     * is negotiated, the message delimiter otherwise, see FrameBuffer
+     */
+    bool extractMessage(std::vector<uint8_t>& message);
+
+    /**
+     * \brief Builds the GET_ALL projection payload
+     * \param fields Mask of Protocol::FIELD_* flags to load
+     * \param bioPreviewLength Bio truncation in bytes, 0 for whole bios
+     * \return std::vector<uint8_t> Payload, empty if none is needed
+     */
+    std::vector<uint8_t> projectionPayload(uint8_t fields, uint16_t bioPreviewLength) const;
+
+    /**
+     * \brief Creates a roster decoder for the negotiated encoding
+     * \param command Protocol::GET_ALL or Protocol::GET_ALL_COLUMNAR
+     * \return std::unique_ptr<RosterStreamDecoder> Fresh decoder
+     */
+    std::unique_ptr<RosterStreamDecoder> makeStreamDecoder(uint8_t command) const;
+
+    /**
+     * \brief Starts streaming a framed GET_ALL response
+     * \return bool True if the buffer head was taken over by a stream
+     *
+     * \details Only the length prefix and command byte need to be
+     * buffered, the payload is fed to the decoder as it arrives
+     */
+    bool beginStream();
+
+    /**
+     * \brief Feeds buffered bytes of the current stream to its decoder
+     * \return bool True if any bytes were consumed
+     */
+    bool continueStream();
+
+    /**
+     * \brief Decodes stream payload bytes and emits complete records
+     * \param data Payload bytes
+     * \param size Number of bytes
+     */
+    void feedStream(const uint8_t* data, size_t size);
+
+    /**
+     * \brief Ends the current stream once its payload is consumed
+     */
+    void endStream();
+
+    /**
+     * \brief Finishes feature negotiation
+     * \param features Features accepted by the server
+     */
+    void completeHandshake(uint32_t features);
+
+    /**
+     * \brief Serializes character with the negotiated encoding
+     * \param character Character to serialize
+     * \return std::vector<uint8_t> Encoded record
+     */
+    std::vector<uint8_t> encodeCharacter(const CharacterData& character) const;
+
+    /**
+     * \brief Deserializes character with the negotiated encoding
+     * \param data Encoded record
+     * \return CharacterData Decoded character
+     */
+    CharacterData decodeCharacter(const std::vector<uint8_t>& data) const;
+
+    /**
+     * \brief Deserializes character vector with the negotiated encoding
+     * \param data Encoded records
+     * \return std::vector<CharacterData> Decoded characters
+     */
+    std::vector<CharacterData> decodeCharacters(const std::vector<uint8_t>& data) const;
+
+    /// Most records emitted in one signalCharactersChunk()
+    static constexpr size_t STREAM_CHUNK_RECORDS = 1024;
+    /// Bytes taken from the socket per read
+    static constexpr qint64 READ_CHUNK_SIZE = 256 * 1024;
+    /// Time spent processing before the event loop gets a turn
+    static constexpr qint64 READ_BUDGET_MS = 16;
+    /// First reconnect delay, doubled per failed attempt
+    static constexpr int RECONNECT_MIN_MS = 500;
+    /// Longest reconnect delay
+    static constexpr int RECONNECT_MAX_MS = 30'000;
+    /// Weight of a new sample in the round-trip average
+    static constexpr double RTT_ALPHA = 0.2;
+
+    /// Protocol::FEATURE_* flags offered in HELLO
+    static constexpr uint32_t SUPPORTED_FEATURES =
+            Protocol::FEATURE_LENGTH_FRAMED | Protocol::FEATURE_VARINT_ENCODING |
+            Protocol::FEATURE_COLUMNAR | Protocol::FEATURE_PROJECTION |
+            Protocol::FEATURE_BATCH_ADD | Protocol::FEATURE_STATS |
+            Protocol::FEATURE_QUERY;
+
+    Transport::Kind m_kind;                   ///< Transport to the server
+    QString m_host;                           ///< Server hostname/IP address or socket name
+    quint16 m_port;                           ///< Server port
+    Transport* m_transport;                   ///< Connection to the server
+    QTimer* m_reconnectTimer;                 ///< Delays the next connection attempt
+    QTimer* m_handshakeTimer;                 ///< Bounds the wait for the HELLO answer
+    int m_reconnectDelayMs = RECONNECT_MIN_MS; ///< Delay before the next attempt
+    bool m_open = false;                      ///< Connection is wanted, reconnect when lost
+    bool m_ready = false;                     ///< Connected and negotiated
+    FrameBuffer m_buffer{DEFAULT_MAX_FRAME_SIZE}; ///< Received bytes, also the frame size limit
+    std::deque<Request> m_pending;            ///< Requests awaiting a response, oldest first
+    RosterStream m_stream;                    ///< Roster stream being received
+    bool m_subscribed = false;                ///< Change notifications are active
+    uint32_t m_features = 0;                  ///< Negotiated Protocol::FEATURE_* flags
+    bool m_readPaused = false;                ///< Received data is left in the socket
+    BufferStats m_stats;                      ///< Receive-side memory counters
+    QElapsedTimer m_clock;                    ///< Time base for round-trip samples
+    double m_rttMs = 0.0;                     ///< Round-trip moving average
+    qint64 m_lastRttSampleNs = -1;            ///< Time of the last sample, -1 if none
+    qint64 m_lastActivityNs = 0;              ///< Time data was last received
+};
+
+#endif // SERVER_LINK_H
@@ -0,0 +1,205 @@
+#include "shared_memory_transport.h"
+
+#include <algorithm>
+#include <new>
+
+#include <QCoreApplication>
+
+namespace {
+// Any byte wakes the peer, its value is ignored
+constexpr char DOORBELL = 1;
+// Tells apart the segments of several transports in one process
+int segments_created = 0;
+}
+
+SharedMemoryTransport::SharedMemoryTransport(const QString& name, QObject* parent)
+    : Transport(parent), m_name(name), m_doorbell(new QLocalSocket(this))
+{
+    connect(m_doorbell, &QLocalSocket::connected, this, &SharedMemoryTransport::slotDoorbellConnected);
+    connect(m_doorbell, &QLocalSocket::disconnected, this, &SharedMemoryTransport::slotDoorbellDisconnected);
+    connect(m_doorbell, &QLocalSocket::readyRead, this, &SharedMemoryTransport::slotDoorbellReadyRead);
+    connect(m_doorbell, &QLocalSocket::errorOccurred, this, &SharedMemoryTransport::slotDoorbellError);
+}
+
+void SharedMemoryTransport::connectToServer() {
+    m_error.clear();
+    m_doorbell->connectToServer(m_name);
+}
+
+void SharedMemoryTransport::disconnectFromServer() {
+    m_doorbell->disconnectFromServer();
+}
+
+void SharedMemoryTransport::abort() {
+    m_doorbell->abort();
+}
+
+Transport::State SharedMemoryTransport::state() const {
+    switch (m_doorbell->state()) {
+    case QLocalSocket::UnconnectedState:
+        return State::Unconnected;
+    case QLocalSocket::ConnectingState:
+        return State::Connecting;
+    case QLocalSocket::ConnectedState:
+        // The segment is set up right after the doorbell connects
+        return m_connected ? State::Connected : State::Connecting;
+    default:
+        return State::Closing;
+    }
+}
+
+qint64 SharedMemoryTransport::bytesAvailable() {
+    if (!m_connected) {
+        return 0;
+    }
+    size_t available = m_incoming.available();
+    // About to go idle, the server has to ring for more
+    if (available == 0 && !m_incoming.waitForData()) {
+        available = m_incoming.available();
+    }
+    return static_cast<qint64>(available);
+}
+
+QByteArray SharedMemoryTransport::read(qint64 maxSize) {
+    if (!m_connected || maxSize <= 0) {
+        return QByteArray();
+    }
+
+    QByteArray data;
+    data.resize(static_cast<qsizetype>(std::min<size_t>(maxSize, m_incoming.available())));
+    const size_t size = m_incoming.read(reinterpret_cast<uint8_t*>(data.data()), data.size());
+    data.resize(static_cast<qsizetype>(size));
+    // Room was made for a server waiting to write
+    if (size > 0 && m_incoming.takeWriterWakeup()) {
+        ring();
+    }
+    return data;
+}
+
+qint64 SharedMemoryTransport::write(const char* data, qint64 size) {
+    if (!m_connected) {
+        return -1;
+    }
+
+    qint64 written = 0;
+    // Queued bytes go first, order is kept
+    if (m_queued.isEmpty()) {
+        written = static_cast<qint64>(m_outgoing.write(reinterpret_cast<const uint8_t*>(data), size));
+        if (written > 0 && m_outgoing.takeReaderWakeup()) {
+            ring();
+        }
+    }
+    if (written < size) {
+        m_queued.append(data + written, size - written);
+        pumpOutgoing();
+    }
+    return size;
+}
+
+void SharedMemoryTransport::flush() {
+    pumpOutgoing();
+    m_doorbell->flush();
+}
+
+QString SharedMemoryTransport::errorString() const {
+    return m_error.isEmpty() ? m_doorbell->errorString() : m_error;
+}
+
+void SharedMemoryTransport::slotDoorbellConnected() {
+    if (!createSegment()) {
+        // Never connected, ends with the error alone
+        m_doorbell->abort();
+        emit signalError(m_error);
+        return;
+    }
+
+    QByteArray key = m_memory.key().toUtf8();
+    key.append('\n');
+    m_doorbell->write(key);
+    m_doorbell->flush();
+    m_connected = true;
+    emit signalConnected();
+}
+
+void SharedMemoryTransport::slotDoorbellDisconnected() {
+    const bool wasConnected = m_connected;
+    m_connected = false;
+    m_outgoing = SharedRing();
+    m_incoming = SharedRing();
+    m_queued.clear();
+    m_memory.detach();
+    if (wasConnected) {
+        emit signalDisconnected();
+    }
+}
+
+void SharedMemoryTransport::slotDoorbellReadyRead() {
+    // Wakeups carry nothing, one look at both rings answers them all
+    m_doorbell->readAll();
+    if (!m_connected) {
+        return;
+    }
+    pumpOutgoing();
+    if (bytesAvailable() > 0) {
+        emit signalReadyRead();
+    }
+}
+
+void SharedMemoryTransport::slotDoorbellError(QLocalSocket::LocalSocketError error) {
+    Q_UNUSED(error)
+    emit signalError(m_doorbell->errorString());
+}
+
+bool SharedMemoryTransport::createSegment() {
+    const size_t size = sizeof(SegmentHeader) + 2 * SharedRing::bytesRequired(RING_CAPACITY);
+    m_memory.setKey(QString("character_client.%1.%2")
+                    .arg(QCoreApplication::applicationPid()).arg(++segments_created));
+    if (!m_memory.create(static_cast<qsizetype>(size))) {
+        // Left behind by a crashed process that had the same PID
+        if (m_memory.error() == QSharedMemory::AlreadyExists && m_memory.attach()) {
+            m_memory.detach();
+        }
+        if (!m_memory.create(static_cast<qsizetype>(size))) {
+            m_error = "Shared memory: " + m_memory.errorString();
+            return false;
+        }
+    }
+
+    uint8_t* base = static_cast<uint8_t*>(m_memory.data());
+    SegmentHeader* header = new (base) SegmentHeader();
+    header->magic = SEGMENT_MAGIC;
+    header->version = SEGMENT_VERSION;
+    header->capacity = RING_CAPACITY;
+
+    uint8_t* controls = base + sizeof(SegmentHeader);
+    uint8_t* data = controls + 2 * sizeof(SharedRing::Control);
+    m_outgoing = SharedRing(new (controls) SharedRing::Control(), data, RING_CAPACITY);
+    m_incoming = SharedRing(new (controls + sizeof(SharedRing::Control)) SharedRing::Control(),
+                            data + RING_CAPACITY, RING_CAPACITY);
+    m_outgoing.reset();
+    m_incoming.reset();
+    return true;
+}
+
+void SharedMemoryTransport::pumpOutgoing() {
+    while (m_connected && !m_queued.isEmpty()) {
+        const size_t written = m_outgoing.write(reinterpret_cast<const uint8_t*>(m_queued.constData()),
+                                                static_cast<size_t>(m_queued.size()));
+        if (written > 0) {
+            m_queued.remove(0, static_cast<qsizetype>(written));
+            if (m_outgoing.takeReaderWakeup()) {
+                ring();
+            }
+            continue;
+        }
+        // Full, the server rings once it has read some
+        if (m_outgoing.waitForSpace()) {
+            break;
+        }
+    }
+}
+
+void SharedMemoryTransport::ring() {
+    m_doorbell->write(&DOORBELL, 1);
+    m_doorbell->flush();
+}
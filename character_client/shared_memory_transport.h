@@ -0,0 +1,145 @@
+/**
+ * \file shared_memory_transport.h
+ * \brief Transport through rings in memory shared with a server on the same host
+ */
+
+#ifndef SHARED_MEMORY_TRANSPORT_H
+#define SHARED_MEMORY_TRANSPORT_H
+
+#include <QLocalSocket>
+#include <QSharedMemory>
+#include "shared_ring.h"
+#include "transport.h"
+
+/**
+ * \class SharedMemoryTransport
+ * \brief Transport copying bytes through shared memory, a local socket
+ * carrying only wakeups
+ * \ingroup Network
+ *
+ * \details Connecting:
+ * - The client connects a local socket, the doorbell, to the server
+ * - It creates a segment holding two SharedRing, client to server and
+ *   server to client, and sends the segment key followed by '\\n'
+ * - The server attaches with QSharedMemory::setKey() and attach(), or
+ *   closes the doorbell if it cannot
+ *
+ * Segment layout, native byte order, each part aligned to 64 bytes:
+ * - Header: uint32_t SEGMENT_MAGIC, uint32_t SEGMENT_VERSION, uint32_t
+ *   ring capacity, a power of two
+ * - SharedRing::Control of the client to server ring, then of the server
+ *   to client ring
+ * - Data area of the client to server ring, then of the server to client
+ *   ring, capacity bytes each
+ *
+ * Afterwards either side writes a single byte to the doorbell when the
+ * other one waits for data or for space, see SharedRing. A side woken by
+ * the doorbell drains its incoming ring and retries its pending writes,
+ * the byte carries no meaning. A busy stream therefore costs no system
+ * call per message, and neither a copy into the kernel nor one out of it.
+ * Closing the doorbell ends the connection.
+ */
+class SharedMemoryTransport : public Transport {
+    Q_OBJECT
+
+public:
+    /**
+     * \brief Constructs an unconnected transport
+     * \param name Doorbell socket name, or its path
+     * \param parent Optional QObject parent
+     */
+    explicit SharedMemoryTransport(const QString& name, QObject* parent = nullptr);
+
+    void connectToServer() override;
+    void disconnectFromServer() override;
+    void abort() override;
+    State state() const override;
+
+    /**
+     * \brief Returns the bytes that can be read without waiting
+     * \return qint64 Received bytes not read yet
+     *
+     * \note Returning 0 lets the server know the next byte it writes
+     * has to ring the doorbell
+     */
+    qint64 bytesAvailable() override;
+
+    QByteArray read(qint64 maxSize) override;
+    qint64 write(const char* data, qint64 size) override;
+    void flush() override;
+
+    /**
+     * \brief Ignored, unread data is bounded by the server to client ring
+     * \param bytes Requested read buffer size
+     *
+     * \note At most RING_CAPACITY bytes are received ahead of the reader,
+     * the server waits for space beyond that
+     */
+    void setReadBufferSize(qint64 bytes) override { Q_UNUSED(bytes) }
+
+    QString errorString() const override;
+
+    static constexpr uint32_t SEGMENT_MAGIC = 0x4D485343;   ///< "CSHM"
+    static constexpr uint32_t SEGMENT_VERSION = 1;          ///< Layout described above
+    static constexpr uint32_t RING_CAPACITY = 4u << 20;     ///< Bytes per direction, also the read bound
+
+private slots:
+    /**
+     * \brief Sets up the segment once the doorbell is connected
+     */
+    void slotDoorbellConnected();
+
+    /**
+     * \brief Releases the segment when the doorbell closes
+     */
+    void slotDoorbellDisconnected();
+
+    /**
+     * \brief Handles a wakeup from the server
+     */
+    void slotDoorbellReadyRead();
+
+    /**
+     * \brief Reports doorbell errors
+     * \param error Error code
+     */
+    void slotDoorbellError(QLocalSocket::LocalSocketError error);
+
+private:
+    /**
+     * \struct SegmentHeader
+     * \brief Start of the segment, identifies the layout
+     */
+    struct alignas(64) SegmentHeader {
+        uint32_t magic;     ///< SEGMENT_MAGIC
+        uint32_t version;   ///< SEGMENT_VERSION
+        uint32_t capacity;  ///< Data area size of each ring
+    };
+
+    /**
+     * \brief Creates and lays out the segment
+     * \return bool True on success, m_error is set otherwise
+     */
+    bool createSegment();
+
+    /**
+     * \brief Moves queued bytes into the outgoing ring while there is room
+     */
+    void pumpOutgoing();
+
+    /**
+     * \brief Wakes the server
+     */
+    void ring();
+
+    QString m_name;             ///< Doorbell socket name or path
+    QLocalSocket* m_doorbell;   ///< Wakeups in both directions
+    QSharedMemory m_memory;     ///< Segment holding both rings
+    SharedRing m_outgoing;      ///< Client to server ring
+    SharedRing m_incoming;      ///< Server to client ring
+    QByteArray m_queued;        ///< Written bytes the outgoing ring had no room for
+    QString m_error;            ///< Own error, overrides the doorbell's
+    bool m_connected = false;   ///< signalConnected() has been emitted
+};
+
+#endif // SHARED_MEMORY_TRANSPORT_H
@@ -0,0 +1,87 @@
+#include "shared_ring.h"
+
+#include <algorithm>
+#include <cstring>
+
+SharedRing::SharedRing(Control* control, uint8_t* data, uint32_t capacity)
+    : m_control(control), m_data(data), m_capacity(capacity)
+{
+}
+
+void SharedRing::reset() {
+    m_control->head.store(0, std::memory_order_relaxed);
+    m_control->tail.store(0, std::memory_order_relaxed);
+    m_control->readerWaiting.store(1, std::memory_order_relaxed);
+    m_control->writerWaiting.store(0, std::memory_order_release);
+}
+
+size_t SharedRing::available() const {
+    const uint64_t head = m_control->head.load(std::memory_order_acquire);
+    const uint64_t tail = m_control->tail.load(std::memory_order_acquire);
+    return static_cast<size_t>(head - tail);
+}
+
+size_t SharedRing::read(uint8_t* out, size_t maxSize) {
+    const uint64_t head = m_control->head.load(std::memory_order_acquire);
+    const uint64_t tail = m_control->tail.load(std::memory_order_relaxed);
+    const size_t size = std::min<size_t>(maxSize, head - tail);
+    if (size == 0) {
+        return 0;
+    }
+
+    // At most two copies, the second one from the start of the area
+    const size_t offset = tail & (m_capacity - 1);
+    const size_t first = std::min<size_t>(size, m_capacity - offset);
+    std::memcpy(out, m_data + offset, first);
+    std::memcpy(out + first, m_data, size - first);
+    m_control->tail.store(tail + size, std::memory_order_release);
+    return size;
+}
+
+size_t SharedRing::write(const uint8_t* in, size_t size) {
+    const uint64_t tail = m_control->tail.load(std::memory_order_acquire);
+    const uint64_t head = m_control->head.load(std::memory_order_relaxed);
+    size = std::min<size_t>(size, m_capacity - (head - tail));
+    if (size == 0) {
+        return 0;
+    }
+
+    const size_t offset = head & (m_capacity - 1);
+    const size_t first = std::min<size_t>(size, m_capacity - offset);
+    std::memcpy(m_data + offset, in, first);
+    std::memcpy(m_data, in + first, size - first);
+    m_control->head.store(head + size, std::memory_order_release);
+    return size;
+}
+
+bool SharedRing::waitForData() {
+    m_control->readerWaiting.store(1, std::memory_order_relaxed);
+    // Pairs with the fence in takeReaderWakeup(), one side sees the other
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (available() == 0) {
+        return true;
+    }
+    // A doorbell may still come, it finds nothing and is harmless
+    m_control->readerWaiting.store(0, std::memory_order_relaxed);
+    return false;
+}
+
+bool SharedRing::waitForSpace() {
+    m_control->writerWaiting.store(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (space() == 0) {
+        return true;
+    }
+    m_control->writerWaiting.store(0, std::memory_order_relaxed);
+    return false;
+}
+
+bool SharedRing::takeReaderWakeup() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return m_control->readerWaiting.exchange(0, std::memory_order_relaxed) != 0;
+}
+
+bool SharedRing::takeWriterWakeup() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return m_control->writerWaiting.exchange(0, std::memory_order_relaxed) != 0;
+}
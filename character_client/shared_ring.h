@@ -0,0 +1,136 @@
+/**
+ * \file shared_ring.h
+ * \brief Single-producer single-consumer byte ring for shared memory
+ */
+
+#ifndef SHARED_RING_H
+#define SHARED_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * \class SharedRing
+ * \brief View of a byte ring placed in memory shared by two processes
+ *
+ * \details One process only writes, the other only reads. The control
+ * block and the data area live in the shared segment, the view itself
+ * holds no state and is created by each side over the same memory.
+ * Indices count bytes since reset() and never wrap, the position in the
+ * data area is the index modulo the capacity, a power of two.
+ *
+ * Neither side ever blocks. A side that finds nothing to do announces it
+ * with waitForData() or waitForSpace() and relies on the other one to
+ * wake it, see takeReaderWakeup() and takeWriterWakeup(). The wakeup
+ * itself, a doorbell, is the owner's business.
+ */
+class SharedRing {
+public:
+    /**
+     * \struct Control
+     * \brief Shared state of a ring, indices on separate cache lines
+     */
+    struct Control {
+        alignas(64) std::atomic<uint64_t> head;     ///< Bytes written, advanced by the writer
+        std::atomic<uint32_t> readerWaiting;        ///< Reader found the ring empty
+        alignas(64) std::atomic<uint64_t> tail;     ///< Bytes read, advanced by the reader
+        std::atomic<uint32_t> writerWaiting;        ///< Writer found the ring full
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "Ring indices must be lock-free to be shared");
+
+    /**
+     * \brief Creates a view over existing memory
+     * \param control Control block in the shared segment
+     * \param data Data area in the shared segment, capacity bytes
+     * \param capacity Size of the data area, a power of two
+     */
+    SharedRing(Control* control, uint8_t* data, uint32_t capacity);
+
+    /**
+     * \brief Creates a view over nothing, for members set up later
+     */
+    SharedRing() = default;
+
+    /**
+     * \brief Empties the ring, only before the other side attaches
+     *
+     * \note The reader starts out waiting, the first write wakes it
+     */
+    void reset();
+
+    /**
+     * \brief Returns whether the view refers to a ring
+     * \return bool True if constructed over shared memory
+     */
+    bool isValid() const { return m_control != nullptr; }
+
+    /**
+     * \brief Returns the bytes waiting to be read
+     * \return size_t Bytes written and not read yet
+     */
+    size_t available() const;
+
+    /**
+     * \brief Returns the room left for the writer
+     * \return size_t Bytes that can be written without waiting
+     */
+    size_t space() const { return m_capacity - available(); }
+
+    /**
+     * \brief Copies bytes out of the ring, reader only
+     * \param out Destination
+     * \param maxSize Most bytes to read
+     * \return size_t Bytes read, 0 if the ring is empty
+     */
+    size_t read(uint8_t* out, size_t maxSize);
+
+    /**
+     * \brief Copies bytes into the ring, writer only
+     * \param in Source
+     * \param size Bytes to write
+     * \return size_t Bytes written, fewer than size if the ring filled up
+     */
+    size_t write(const uint8_t* in, size_t size);
+
+    /**
+     * \brief Announces that the reader is about to sleep, reader only
+     * \return bool True if the ring is still empty and the reader must
+     * wait for its doorbell, false if data arrived meanwhile
+     */
+    bool waitForData();
+
+    /**
+     * \brief Announces that the writer is about to sleep, writer only
+     * \return bool True if the ring is still full and the writer must
+     * wait for its doorbell, false if space was freed meanwhile
+     */
+    bool waitForSpace();
+
+    /**
+     * \brief Clears the reader's wait flag, writer only, after writing
+     * \return bool True if the reader was waiting and has to be woken
+     */
+    bool takeReaderWakeup();
+
+    /**
+     * \brief Clears the writer's wait flag, reader only, after reading
+     * \return bool True if the writer was waiting and has to be woken
+     */
+    bool takeWriterWakeup();
+
+    /**
+     * \brief Returns the shared memory needed by one ring
+     * \param capacity Size of the data area
+     * \return size_t Control block and data area
+     */
+    static size_t bytesRequired(uint32_t capacity) { return sizeof(Control) + capacity; }
+
+private:
+    Control* m_control = nullptr;   ///< Shared indices and wait flags
+    uint8_t* m_data = nullptr;      ///< Shared data area
+    uint32_t m_capacity = 0;        ///< Data area size, a power of two
+};
+
+#endif // SHARED_RING_H
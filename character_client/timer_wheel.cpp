@@ -0,0 +1,62 @@
+#include "timer_wheel.h"
+
+#include <algorithm>
+
+TimerWheel::TimerWheel(int64_t tickMs, size_t slots)
+    : m_tickMs(std::max<int64_t>(tickMs, 1)), m_slots(std::max<size_t>(slots, 1))
+{
+}
+
+void TimerWheel::schedule(uint64_t key, int64_t nowMs, int64_t delayMs) {
+    cancel(key);
+
+    const int64_t due = std::max<int64_t>(nowMs + std::max<int64_t>(delayMs, 0), 0);
+    // Rounded up, a timer never fires early
+    uint64_t tick = static_cast<uint64_t>((due + m_tickMs - 1) / m_tickMs);
+    tick = std::max(tick, m_current + 1);
+
+    m_slots[tick % m_slots.size()].push_back({key, tick});
+    m_expiry[key] = tick;
+}
+
+bool TimerWheel::cancel(uint64_t key) {
+    auto it = m_expiry.find(key);
+    if (it == m_expiry.end()) {
+        return false;
+    }
+
+    auto& slot = m_slots[it->second % m_slots.size()];
+    auto entry = std::find_if(slot.begin(), slot.end(),
+                              [key](const Entry& e) { return e.key == key; });
+    if (entry != slot.end()) {
+        *entry = slot.back();
+        slot.pop_back();
+    }
+    m_expiry.erase(it);
+    return true;
+}
+
+void TimerWheel::advance(int64_t nowMs, std::vector<uint64_t>& expired) {
+    const uint64_t target = static_cast<uint64_t>(std::max<int64_t>(nowMs, 0) / m_tickMs);
+    if (target <= m_current) {
+        return;
+    }
+
+    // After a long gap every slot is due once, no need to go round again
+    const uint64_t steps = std::min<uint64_t>(target - m_current, m_slots.size());
+    for (uint64_t step = 1; step <= steps; ++step) {
+        auto& slot = m_slots[(m_current + step) % m_slots.size()];
+        for (size_t i = 0; i < slot.size();) {
+            if (slot[i].tick > target) {
+                // Due in a later revolution
+                ++i;
+                continue;
+            }
+            expired.push_back(slot[i].key);
+            m_expiry.erase(slot[i].key);
+            slot[i] = slot.back();
+            slot.pop_back();
+        }
+    }
+    m_current = target;
+}
@@ -0,0 +1,86 @@
+/**
+ * \file timer_wheel.h
+ * \brief Hashed timer wheel for per-request deadlines
+ */
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * \class TimerWheel
+ * \brief Many one-shot timers driven by a single periodic tick
+ *
+ * \details Timers are hashed into slots by their expiry tick, so
+ * scheduling, cancelling and expiring a timer do not depend on how many
+ * others are pending. Timers further away than one revolution stay in
+ * their slot until their tick comes around. Resolution is one tick.
+ *
+ * The wheel keeps no clock, the owner passes the current time in
+ * milliseconds and calls advance() at least once per tick while
+ * !empty().
+ */
+class TimerWheel {
+public:
+    /**
+     * \brief Constructs an empty wheel
+     * \param tickMs Resolution in milliseconds
+     * \param slots Number of slots in one revolution
+     */
+    TimerWheel(int64_t tickMs, size_t slots);
+
+    /**
+     * \brief Schedules a timer, replacing any pending one with the same key
+     * \param key Caller-chosen timer identifier
+     * \param nowMs Current time
+     * \param delayMs Time until expiry, rounded up to whole ticks
+     */
+    void schedule(uint64_t key, int64_t nowMs, int64_t delayMs);
+
+    /**
+     * \brief Cancels a pending timer
+     * \param key Timer identifier
+     * \return bool True if the timer was pending
+     */
+    bool cancel(uint64_t key);
+
+    /**
+     * \brief Expires every timer due by now
+     * \param nowMs Current time
+     * \param expired [out] Keys of the expired timers are appended
+     */
+    void advance(int64_t nowMs, std::vector<uint64_t>& expired);
+
+    /**
+     * \brief Returns whether any timer is pending
+     * \return bool True if nothing is scheduled
+     */
+    bool empty() const { return m_expiry.empty(); }
+
+    /**
+     * \brief Returns the resolution
+     * \return int64_t Tick length in milliseconds
+     */
+    int64_t tickMs() const { return m_tickMs; }
+
+private:
+    /**
+     * \struct Entry
+     * \brief Timer stored in a slot
+     */
+    struct Entry {
+        uint64_t key;     ///< Timer identifier
+        uint64_t tick;    ///< Tick the timer expires at
+    };
+
+    int64_t m_tickMs;                                 ///< Tick length
+    std::vector<std::vector<Entry>> m_slots;          ///< Timers by expiry tick modulo slot count
+    std::unordered_map<uint64_t, uint64_t> m_expiry;  ///< Expiry tick of each pending timer
+    uint64_t m_current = 0;                           ///< Last tick processed
+};
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,65 @@
+#include "transport.h"
+#include "shared_memory_transport.h"
+
+Transport* Transport::create(Kind kind, const QString& host, quint16 port, QObject* parent) {
+    switch (kind) {
+    case Kind::Local:
+        return new LocalTransport(host, parent);
+    case Kind::SharedMemory:
+        return new SharedMemoryTransport(host, parent);
+    default:
+        return new TcpTransport(host, port, parent);
+    }
+}
+
+TcpTransport::TcpTransport(const QString& host, quint16 port, QObject* parent)
+    : Transport(parent), m_host(host), m_port(port), m_socket(new QTcpSocket(this))
+{
+    connect(m_socket, &QTcpSocket::connected, this, &Transport::signalConnected);
+    connect(m_socket, &QTcpSocket::disconnected, this, &Transport::signalDisconnected);
+    connect(m_socket, &QTcpSocket::readyRead, this, &Transport::signalReadyRead);
+// In Qt 5.14 and earlier there is signal error(), no errorOccured
+    connect(m_socket, QOverload<QAbstractSocket::SocketError>::of(&QAbstractSocket::errorOccurred),
+            this, [this]() { emit signalError(m_socket->errorString()); });
+}
+
+void TcpTransport::connectToServer() {
+    m_socket->connectToHost(m_host, m_port);
+}
+
+Transport::State TcpTransport::state() const {
+    switch (m_socket->state()) {
+    case QAbstractSocket::UnconnectedState:
+        return State::Unconnected;
+    case QAbstractSocket::ConnectedState:
+        return State::Connected;
+    case QAbstractSocket::ClosingState:
+        return State::Closing;
+    default:
+        // Host lookup and connecting alike
+        return State::Connecting;
+    }
+}
+
+LocalTransport::LocalTransport(const QString& name, QObject* parent)
+    : Transport(parent), m_name(name), m_socket(new QLocalSocket(this))
+{
+    connect(m_socket, &QLocalSocket::connected, this, &Transport::signalConnected);
+    connect(m_socket, &QLocalSocket::disconnected, this, &Transport::signalDisconnected);
+    connect(m_socket, &QLocalSocket::readyRead, this, &Transport::signalReadyRead);
+    connect(m_socket, &QLocalSocket::errorOccurred,
+            this, [this]() { emit signalError(m_socket->errorString()); });
+}
+
+Transport::State LocalTransport::state() const {
+    switch (m_socket->state()) {
+    case QLocalSocket::UnconnectedState:
+        return State::Unconnected;
+    case QLocalSocket::ConnectingState:
+        return State::Connecting;
+    case QLocalSocket::ConnectedState:
+        return State::Connected;
+    default:
+        return State::Closing;
+    }
+}
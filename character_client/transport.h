@@ -0,0 +1,207 @@
+/**
+ * \file transport.h
+ * \brief Byte stream to a character server, independent of how it is carried
+ */
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <QByteArray>
+#include <QLocalSocket>
+#include <QObject>
+#include <QString>
+#include <QTcpSocket>
+
+/**
+ * \class Transport
+ * \brief Connection a ServerLink speaks Protocol over
+ * \ingroup Network
+ *
+ * \details Every backend carries the same ordered byte stream, framing and
+ * negotiation are left to ServerLink. Behaves like a socket: data is read
+ * after signalReadyRead(), writes never block and are buffered as needed,
+ * signalDisconnected() follows only a signalConnected(), a failed attempt
+ * ends with signalError() alone.
+ *
+ * \see create()
+ */
+class Transport : public QObject {
+    Q_OBJECT
+
+public:
+    /**
+     * \brief How bytes reach the server
+     */
+    enum class Kind {
+        Tcp,            ///< TCP socket, host and port
+        Local,          ///< Unix domain socket or named pipe
+        SharedMemory    ///< Rings in shared memory, a local socket as doorbell
+    };
+
+    /**
+     * \brief Connection state
+     */
+    enum class State {
+        Unconnected,    ///< Idle, connectToServer() may be called
+        Connecting,     ///< Attempt under way
+        Connected,      ///< Bytes can be exchanged
+        Closing         ///< Disconnecting, written data is still sent
+    };
+
+    /**
+     * \brief Creates the backend for an endpoint
+     * \param kind Backend to use
+     * \param host Server hostname/IP address, or the socket name for local kinds
+     * \param port Server port, TCP only
+     * \param parent Optional QObject parent
+     * \return Transport* New unconnected transport
+     */
+    static Transport* create(Kind kind, const QString& host, quint16 port, QObject* parent = nullptr);
+
+    using QObject::QObject;
+
+    /**
+     * \brief Starts a connection attempt
+     *
+     * \note Emits signalConnected() or signalError()
+     */
+    virtual void connectToServer() = 0;
+
+    /**
+     * \brief Closes the connection once written data is sent
+     */
+    virtual void disconnectFromServer() = 0;
+
+    /**
+     * \brief Closes the connection at once, discarding unsent data
+     */
+    virtual void abort() = 0;
+
+    /**
+     * \brief Returns the connection state
+     * \return State Current state
+     */
+    virtual State state() const = 0;
+
+    /**
+     * \brief Returns the bytes that can be read without waiting
+     * \return qint64 Received bytes not read yet
+     */
+    virtual qint64 bytesAvailable() = 0;
+
+    /**
+     * \brief Reads received bytes
+     * \param maxSize Most bytes to read
+     * \return QByteArray Bytes read, empty if none are available
+     */
+    virtual QByteArray read(qint64 maxSize) = 0;
+
+    /**
+     * \brief Queues bytes for sending
+     * \param data Bytes to send
+     * \param size Number of bytes
+     * \return qint64 Bytes accepted, -1 on error
+     */
+    virtual qint64 write(const char* data, qint64 size) = 0;
+
+    /**
+     * \brief Sends as much queued data as possible without blocking
+     */
+    virtual void flush() = 0;
+
+    /**
+     * \brief Limits the bytes received ahead of the reader
+     * \param bytes Read buffer size, 0 for unlimited
+     *
+     * \note Backends bounded by design ignore it
+     */
+    virtual void setReadBufferSize(qint64 bytes) = 0;
+
+    /**
+     * \brief Returns the last error
+     * \return QString Human-readable description
+     */
+    virtual QString errorString() const = 0;
+
+signals:
+    /// \brief Emitted when the connection is up
+    void signalConnected();
+    /// \brief Emitted when an established connection is gone
+    void signalDisconnected();
+    /// \brief Emitted when new data can be read
+    void signalReadyRead();
+    /**
+     * \brief Emitted when an attempt fails or the connection breaks
+     * \param message Error description
+     */
+    void signalError(const QString& message);
+};
+
+/**
+ * \class TcpTransport
+ * \brief Transport over a QTcpSocket
+ */
+class TcpTransport : public Transport {
+    Q_OBJECT
+
+public:
+    /**
+     * \brief Constructs an unconnected transport
+     * \param host Server hostname/IP address
+     * \param port Server port
+     * \param parent Optional QObject parent
+     */
+    TcpTransport(const QString& host, quint16 port, QObject* parent = nullptr);
+
+    void connectToServer() override;
+    void disconnectFromServer() override { m_socket->disconnectFromHost(); }
+    void abort() override { m_socket->abort(); }
+    State state() const override;
+    qint64 bytesAvailable() override { return m_socket->bytesAvailable(); }
+    QByteArray read(qint64 maxSize) override { return m_socket->read(maxSize); }
+    qint64 write(const char* data, qint64 size) override { return m_socket->write(data, size); }
+    void flush() override { m_socket->flush(); }
+    void setReadBufferSize(qint64 bytes) override { m_socket->setReadBufferSize(bytes); }
+    QString errorString() const override { return m_socket->errorString(); }
+
+private:
+    QString m_host;         ///< Server hostname/IP address
+    quint16 m_port;         ///< Server port
+    QTcpSocket* m_socket;   ///< TCP socket instance
+};
+
+/**
+ * \class LocalTransport
+ * \brief Transport over a QLocalSocket, a Unix domain socket or named pipe
+ *
+ * \details Skips the TCP/IP stack that loopback connections still go
+ * through, for servers on the same host
+ */
+class LocalTransport : public Transport {
+    Q_OBJECT
+
+public:
+    /**
+     * \brief Constructs an unconnected transport
+     * \param name Socket name, or its path
+     * \param parent Optional QObject parent
+     */
+    explicit LocalTransport(const QString& name, QObject* parent = nullptr);
+
+    void connectToServer() override { m_socket->connectToServer(m_name); }
+    void disconnectFromServer() override { m_socket->disconnectFromServer(); }
+    void abort() override { m_socket->abort(); }
+    State state() const override;
+    qint64 bytesAvailable() override { return m_socket->bytesAvailable(); }
+    QByteArray read(qint64 maxSize) override { return m_socket->read(maxSize); }
+    qint64 write(const char* data, qint64 size) override { return m_socket->write(data, size); }
+    void flush() override { m_socket->flush(); }
+    void setReadBufferSize(qint64 bytes) override { m_socket->setReadBufferSize(bytes); }
+    QString errorString() const override { return m_socket->errorString(); }
+
+private:
+    QString m_name;         ///< Socket name or path
+    QLocalSocket* m_socket; ///< Local socket instance
+};
+
+#endif // TRANSPORT_H
@@ -0,0 +1,34 @@
+# Multiplexing proxy between many clients and one character server.
+# Shares the protocol definitions with the client, no GUI.
+
+QT       += core network
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = character_proxy
+
+INCLUDEPATH += ../character_client
+
+SOURCES += \
+    ../character_client/frame_buffer.cpp \
+    ../character_client/protocol.cpp \
+    downstream_session.cpp \
+    main.cpp \
+    proxy_server.cpp \
+    response_cache.cpp \
+    upstream_link.cpp
+
+HEADERS += \
+    ../character_client/frame_buffer.h \
+    ../character_client/protocol.h \
+    downstream_session.h \
+    proxy_server.h \
+    response_cache.h \
+    upstream_link.h
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
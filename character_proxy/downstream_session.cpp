@@ -0,0 +1,121 @@
+#include "downstream_session.h"
+#include "protocol.h"
+
+#include <QDebug>
+#include <QHostAddress>
+#include <QTimer>
+#include <cstring>
+#include <stdexcept>
+
+DownstreamSession::DownstreamSession(QTcpSocket* socket, uint32_t maxFrameSize, QObject* parent)
+    : QObject(parent), m_socket(socket), m_buffer(maxFrameSize)
+{
+    m_socket->setParent(this);
+    connect(m_socket, &QTcpSocket::readyRead, this, &DownstreamSession::slotReadyRead);
+    connect(m_socket, &QTcpSocket::bytesWritten, this, &DownstreamSession::slotBytesWritten);
+    connect(m_socket, &QTcpSocket::disconnected, this, &DownstreamSession::signalClosed);
+}
+
+QString DownstreamSession::peer() const {
+    return QString("%1:%2").arg(m_socket->peerAddress().toString()).arg(m_socket->peerPort());
+}
+
+void DownstreamSession::close(const QString& reason) {
+    qInfo().noquote() << "Closing" << peer() << "-" << reason;
+    // Emits disconnected
+    m_socket->abort();
+}
+
+void DownstreamSession::answer(quint64 slot, const SharedMessage& message) {
+    if (slot < m_firstSlot || slot - m_firstSlot >= m_slots.size()) {
+        return;
+    }
+    m_slots[slot - m_firstSlot].message = message;
+    flush();
+}
+
+void DownstreamSession::answerHello(quint64 slot, uint32_t features) {
+    if (slot < m_firstSlot || slot - m_firstSlot >= m_slots.size()) {
+        return;
+    }
+
+    auto message = std::make_shared<std::vector<uint8_t>>(1 + sizeof(features));
+    (*message)[0] = Protocol::HELLO;
+    std::memcpy(message->data() + 1, &features, sizeof(features));
+    Slot& entry = m_slots[slot - m_firstSlot];
+    entry.message = message;
+    entry.hello = true;
+    entry.framed = features & Protocol::FEATURE_LENGTH_FRAMED;
+    flush();
+}
+
+void DownstreamSession::notify(const SharedMessage& message) {
+    FrameBuffer::write(m_socket, *message, m_buffer.framed());
+}
+
+void DownstreamSession::flush() {
+    while (!m_slots.empty() && m_slots.front().message) {
+        const Slot entry = m_slots.front();
+        m_slots.pop_front();
+        ++m_firstSlot;
+        FrameBuffer::write(m_socket, *entry.message, m_buffer.framed());
+        // The client switches framing as soon as it reads the answer
+        if (entry.hello) {
+            m_buffer.setFramed(entry.framed);
+            m_helloPending = false;
+        }
+    }
+    resumeReading();
+}
+
+void DownstreamSession::resumeReading() {
+    // Requests held back while the client was over its limits
+    if (m_readBlocked && canRead()) {
+        m_readBlocked = false;
+        QTimer::singleShot(0, this, &DownstreamSession::slotReadyRead);
+    }
+}
+
+bool DownstreamSession::canRead() const {
+    return !m_helloPending && m_slots.size() < MAX_PIPELINED
+            && m_socket->bytesToWrite() < MAX_WRITE_BACKLOG;
+}
+
+void DownstreamSession::slotBytesWritten() {
+    resumeReading();
+}
+
+void DownstreamSession::slotReadyRead() {
+    std::vector<uint8_t> message;
+    while (m_socket->state() == QAbstractSocket::ConnectedState) {
+        if (!canRead()) {
+            // Data already in the socket does not emit readyRead again
+            m_readBlocked = true;
+            return;
+        }
+        try {
+            if (!m_buffer.next(message)) {
+                if (m_socket->bytesAvailable() == 0) {
+                    return;
+                }
+                const QByteArray data = m_socket->read(READ_CHUNK_SIZE);
+                m_buffer.append(data.constData(), static_cast<size_t>(data.size()));
+                continue;
+            }
+        } catch (const std::length_error& e) {
+            close(QString("Protocol error: %1").arg(e.what()));
+            return;
+        }
+
+        if (message.empty()) {
+            close("Protocol error: Empty message");
+            return;
+        }
+        // Later requests may be framed differently, wait for the answer
+        if (message[0] == Protocol::HELLO) {
+            m_helloPending = true;
+        }
+        m_slots.push_back(Slot());
+        emit signalRequest(m_firstSlot + m_slots.size() - 1, message);
+    }
+}
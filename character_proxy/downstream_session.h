@@ -0,0 +1,154 @@
+/**
+ * \file downstream_session.h
+ * \brief Proxy connection from one client
+ */
+
+#ifndef DOWNSTREAM_SESSION_H
+#define DOWNSTREAM_SESSION_H
+
+#include <QObject>
+#include <QTcpSocket>
+#include <deque>
+#include <vector>
+#include "frame_buffer.h"
+
+/**
+ * \class DownstreamSession
+ * \brief Receives the requests of one client and answers them in order
+ *
+ * \details Every request gets a slot when it arrives. Answers may be
+ * filled in out of order, from the cache or from whichever upstream link
+ * carried the request, and are written once every earlier slot has been
+ * answered, as the client matches answers to requests by order.
+ * Notifications do not answer a request and are written at once.
+ *
+ * Reading stops while too many requests are unanswered or too much
+ * output is waiting for the client, so a slow client cannot make the
+ * proxy buffer without bound.
+ */
+class DownstreamSession : public QObject {
+    Q_OBJECT
+
+public:
+    /**
+     * \brief Takes over an accepted connection
+     * \param socket Connected socket, reparented to the session
+     * \param maxFrameSize Largest accepted request
+     * \param parent Optional QObject parent
+     */
+    DownstreamSession(QTcpSocket* socket, uint32_t maxFrameSize, QObject* parent = nullptr);
+
+    /**
+     * \brief Answers a request
+     * \param slot Slot passed with signalRequest()
+     * \param message Answer, command byte first
+     */
+    void answer(quint64 slot, const SharedMessage& message);
+
+    /**
+     * \brief Answers the feature negotiation
+     * \param slot Slot passed with signalRequest()
+     * \param features Accepted Protocol::FEATURE_* flags
+     *
+     * \note Framing switches once the answer is written
+     */
+    void answerHello(quint64 slot, uint32_t features);
+
+    /**
+     * \brief Writes a change notification
+     * \param message Protocol::NOTIFY_CHANGED or Protocol::NOTIFY_REMOVED message
+     */
+    void notify(const SharedMessage& message);
+
+    /**
+     * \brief Returns whether the client subscribed to notifications
+     * \return bool True if notify() should be called
+     */
+    bool isSubscribed() const { return m_subscribed; }
+
+    /**
+     * \brief Records the client's subscription
+     * \param subscribed True if the client receives notifications
+     */
+    void setSubscribed(bool subscribed) { m_subscribed = subscribed; }
+
+    /**
+     * \brief Returns the client address for logging
+     * \return QString Address and port
+     */
+    QString peer() const;
+
+    /**
+     * \brief Drops the connection
+     * \param reason Logged reason
+     */
+    void close(const QString& reason);
+
+signals:
+    /**
+     * \brief Emitted for every complete request
+     * \param slot Slot the answer goes to
+     * \param message Request message, command byte first
+     */
+    void signalRequest(quint64 slot, const std::vector<uint8_t>& message);
+
+    /**
+     * \brief Emitted once the connection is gone
+     */
+    void signalClosed();
+
+private slots:
+    /**
+     * \brief Processes incoming requests
+     */
+    void slotReadyRead();
+
+    /**
+     * \brief Resumes reading once output has drained
+     */
+    void slotBytesWritten();
+
+private:
+    /**
+     * \struct Slot
+     * \brief Request awaiting its turn to be answered
+     */
+    struct Slot {
+        SharedMessage message;      ///< Answer, null until it is known
+        bool hello = false;         ///< Answer negotiates features
+        bool framed = false;        ///< Length framing follows a hello answer
+    };
+
+    /**
+     * \brief Writes every answer whose turn has come
+     */
+    void flush();
+
+    /**
+     * \brief Reads requests held back by canRead() once it allows
+     */
+    void resumeReading();
+
+    /**
+     * \brief Returns whether requests may be read
+     * \return bool False while the client has too much outstanding
+     */
+    bool canRead() const;
+
+    /// Most requests awaiting an answer before reading stops
+    static constexpr size_t MAX_PIPELINED = 1024;
+    /// Most bytes waiting for the client before reading stops
+    static constexpr qint64 MAX_WRITE_BACKLOG = 64 * 1024 * 1024;
+    /// Bytes taken from the socket per read
+    static constexpr qint64 READ_CHUNK_SIZE = 64 * 1024;
+
+    QTcpSocket* m_socket;               ///< Client connection
+    FrameBuffer m_buffer;               ///< Received bytes
+    std::deque<Slot> m_slots;           ///< Unwritten answers, oldest first
+    quint64 m_firstSlot = 1;            ///< Slot of m_slots.front()
+    bool m_subscribed = false;          ///< Client receives notifications
+    bool m_helloPending = false;        ///< Framing may switch before the next request
+    bool m_readBlocked = false;         ///< Reading stopped on canRead()
+};
+
+#endif // DOWNSTREAM_SESSION_H
@@ -0,0 +1,53 @@
+#include "proxy_server.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QStringList>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("character_proxy");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Shares a character server between many clients");
+    parser.addHelpOption();
+    parser.addPositionalArgument("upstream", "Character server, host or host:port");
+    const QCommandLineOption listenOption(
+                "listen", "Port clients connect to.", "port", QString::number(Protocol::PORT));
+    const QCommandLineOption linksOption(
+                "links", "Connections to the server.", "count", "4");
+    const QCommandLineOption cacheOption(
+                "cache-mb", "Memory for cached answers, in MiB.", "size", "256");
+    const QCommandLineOption ttlOption(
+                "ttl-ms", "Answer lifetime if the server pushes no notifications.", "ms", "1000");
+    parser.addOptions({listenOption, linksOption, cacheOption, ttlOption});
+    parser.process(a);
+
+    const QStringList positional = parser.positionalArguments();
+    if (positional.size() != 1) {
+        parser.showHelp(1);
+    }
+
+    ProxyServer::Options options;
+    options.upstreamHost = positional.at(0);
+    const int colon = options.upstreamHost.lastIndexOf(':');
+    if (colon > 0) {
+        bool ok = false;
+        const uint port = options.upstreamHost.mid(colon + 1).toUInt(&ok);
+        options.upstreamHost = options.upstreamHost.left(colon);
+        if (ok && port > 0 && port <= 0xFFFF) {
+            options.upstreamPort = static_cast<quint16>(port);
+        }
+    }
+    options.listenPort = static_cast<quint16>(parser.value(listenOption).toUInt());
+    options.upstreamLinks = parser.value(linksOption).toInt();
+    options.cacheBytes = static_cast<size_t>(parser.value(cacheOption).toULongLong()) * 1024 * 1024;
+    options.unsubscribedTtlMs = parser.value(ttlOption).toLongLong();
+
+    ProxyServer proxy(options);
+    if (!proxy.start()) {
+        return 1;
+    }
+    return a.exec();
+}
@@ -0,0 +1,408 @@
+#include "proxy_server.h"
+
+#include <QDebug>
+#include <QHostAddress>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+/**
+ * \brief Builds a message consisting of a command byte only
+ * \param command Protocol command or response byte
+ * \return SharedMessage The message
+ */
+SharedMessage commandMessage(uint8_t command) {
+    return std::make_shared<const std::vector<uint8_t>>(1, command);
+}
+
+/**
+ * \brief Returns whether an answer reports success
+ * \param message Answer, command byte first
+ * \return bool False for Protocol::RESP_ERROR
+ */
+bool succeeded(const SharedMessage& message) {
+    return !message->empty() && (*message)[0] != Protocol::RESP_ERROR;
+}
+}
+
+ProxyServer::ProxyServer(const Options& options, QObject* parent)
+    : QObject(parent),
+      m_options(options),
+      m_server(new QTcpServer(this)),
+      // Rosters are few and large, single characters many and small
+      m_rosters(options.cacheBytes / 4 * 3),
+      m_characters(options.cacheBytes / 4),
+      m_statsTimer(new QTimer(this))
+{
+    connect(m_server, &QTcpServer::newConnection, this, &ProxyServer::slotNewConnection);
+    connect(m_statsTimer, &QTimer::timeout, this, &ProxyServer::slotLogStats);
+    m_clock.start();
+}
+
+bool ProxyServer::start() {
+    if (!m_server->listen(QHostAddress::Any, m_options.listenPort)) {
+        qWarning().noquote() << "Cannot listen on port" << m_options.listenPort << "-" << m_server->errorString();
+        return false;
+    }
+
+    for (int i = 0; i < std::max(m_options.upstreamLinks, 1); ++i) {
+        auto* link = new UpstreamLink(m_options.upstreamHost, m_options.upstreamPort, m_options.maxFrameSize, this);
+        m_links.push_back(link);
+
+        connect(
+                    link, &UpstreamLink::signalReady,
+                    this, [this, link]() { linkReady(link); }
+                    );
+        connect(
+                    link, &UpstreamLink::signalConnectionFailed,
+                    this, [this](const QString& error) {
+                        qWarning().noquote() << "Upstream" << m_options.upstreamHost << "-" << error;
+                    }
+                    );
+        connect(link, &UpstreamLink::signalAnswered, this, &ProxyServer::complete);
+        connect(link, &UpstreamLink::signalLost, this, &ProxyServer::linkLost);
+        connect(
+                    link, &UpstreamLink::signalNotification,
+                    this, [this, link](const SharedMessage& message) { linkNotification(link, message); }
+                    );
+        connect(
+                    link, &UpstreamLink::signalSubscriptionChanged,
+                    this, [this, link](bool active) { linkSubscriptionChanged(link, active); }
+                    );
+        link->open();
+    }
+
+    m_statsTimer->start(STATS_INTERVAL_MS);
+    qInfo().noquote() << "Listening on port" << m_options.listenPort << "for"
+                      << QString("%1:%2").arg(m_options.upstreamHost).arg(m_options.upstreamPort);
+    return true;
+}
+
+void ProxyServer::slotNewConnection() {
+    while (m_server->hasPendingConnections()) {
+        QTcpSocket* socket = m_server->nextPendingConnection();
+
+        // Sessions are deleted once their client is gone
+        m_sessions.erase(
+                    std::remove_if(m_sessions.begin(), m_sessions.end(),
+                                   [](const QPointer<DownstreamSession>& session) { return session.isNull(); }),
+                    m_sessions.end()
+                    );
+        if (m_sessions.size() >= Protocol::MAX_CONNECTIONS) {
+            qWarning() << "Connection limit reached, refusing client";
+            socket->abort();
+            socket->deleteLater();
+            continue;
+        }
+
+        auto* session = new DownstreamSession(socket, m_options.maxFrameSize, this);
+        m_sessions.push_back(session);
+        connect(
+                    session, &DownstreamSession::signalRequest,
+                    this, [this, session](quint64 slot, const std::vector<uint8_t>& message) {
+                        handleRequest(session, slot, message);
+                    }
+                    );
+        connect(session, &DownstreamSession::signalClosed, session, &QObject::deleteLater);
+    }
+}
+
+void ProxyServer::handleRequest(DownstreamSession* session, quint64 slot, const std::vector<uint8_t>& message) {
+    const uint8_t command = message[0];
+    switch (command) {
+    case Protocol::HELLO:
+        answerHello(session, slot, message);
+        return;
+    case Protocol::SUBSCRIBE:
+        // Clients get exactly what the proxy gets, without it they poll
+        session->setSubscribed(m_subscribed);
+        session->answer(slot, commandMessage(m_subscribed ? Protocol::SUBSCRIBE : Protocol::RESP_ERROR));
+        return;
+    default:
+        break;
+    }
+
+    const bool cacheable = command == Protocol::GET_ALL || command == Protocol::GET_ALL_COLUMNAR
+            || command == Protocol::GET_ONE || command == Protocol::STATS || command == Protocol::QUERY;
+    if (cacheable) {
+        const std::string key(message.begin(), message.end());
+        const qint64 maxAgeMs = m_subscribed ? -1 : m_options.unsubscribedTtlMs;
+        SharedMessage cached = cacheFor(command).find(key, m_clock.elapsed(), maxAgeMs);
+        if (cached) {
+            ++m_stats.hits;
+            session->answer(slot, cached);
+            return;
+        }
+        auto flying = m_inFlight.find(key);
+        if (flying != m_inFlight.end()) {
+            ++m_stats.coalesced;
+            m_flights[flying->second].waiters.push_back({session, slot});
+            return;
+        }
+    }
+
+    const quint64 tag = m_nextTag++;
+    Flight& flight = m_flights[tag];
+    flight.message = message;
+    flight.cacheable = cacheable;
+    flight.waiters.push_back({session, slot});
+    if (cacheable) {
+        m_inFlight.emplace(std::string(message.begin(), message.end()), tag);
+    }
+    dispatch(tag);
+}
+
+void ProxyServer::answerHello(DownstreamSession* session, quint64 slot, const std::vector<uint8_t>& message) {
+    // Features depend on the server, a client arriving first comes back later
+    if (!m_featuresKnown) {
+        session->close("Server unavailable");
+        return;
+    }
+
+    uint32_t offered = 0;
+    if (message.size() >= 1 + sizeof(offered)) {
+        std::memcpy(&offered, message.data() + 1, sizeof(offered));
+    }
+    uint32_t accepted = offered & m_features;
+    // Framing is per client, but columnar payloads are never delimited
+    if (!(accepted & Protocol::FEATURE_LENGTH_FRAMED)) {
+        accepted &= ~Protocol::FEATURE_COLUMNAR;
+    }
+    session->answerHello(slot, accepted);
+}
+
+void ProxyServer::dispatch(quint64 tag) {
+    UpstreamLink* target = nullptr;
+    for (UpstreamLink* link : m_links) {
+        if (link->isReady() && (!target || link->pendingCount() < target->pendingCount())) {
+            target = link;
+        }
+    }
+    if (!target) {
+        ++m_stats.failed;
+        complete(tag, commandMessage(Protocol::RESP_ERROR));
+        return;
+    }
+
+    Flight& flight = m_flights.at(tag);
+    ++flight.attempts;
+    ++m_stats.forwarded;
+    target->send(tag, flight.message);
+}
+
+void ProxyServer::complete(quint64 tag, const SharedMessage& message) {
+    auto it = m_flights.find(tag);
+    if (it == m_flights.end()) {
+        return;
+    }
+    const Flight flight = std::move(it->second);
+    m_flights.erase(it);
+
+    if (flight.cacheable) {
+        const std::string key(flight.message.begin(), flight.message.end());
+        auto flying = m_inFlight.find(key);
+        if (flying != m_inFlight.end() && flying->second == tag) {
+            m_inFlight.erase(flying);
+        }
+        // Errors may be transient, they are not remembered
+        if (!flight.stale && succeeded(message)) {
+            cacheFor(flight.message[0]).insert(key, message, m_clock.elapsed());
+        }
+    } else if (succeeded(message)) {
+        invalidateMutation(flight.message);
+    }
+
+    for (const Waiter& waiter : flight.waiters) {
+        if (waiter.session) {
+            waiter.session->answer(waiter.slot, message);
+        }
+    }
+}
+
+void ProxyServer::linkLost(const std::vector<quint64>& tags) {
+    for (quint64 tag : tags) {
+        auto it = m_flights.find(tag);
+        if (it == m_flights.end()) {
+            continue;
+        }
+        // Mutations may have been applied, only reads are sent again
+        if (it->second.cacheable && it->second.attempts < MAX_ATTEMPTS) {
+            dispatch(tag);
+            continue;
+        }
+        ++m_stats.failed;
+        complete(tag, commandMessage(Protocol::RESP_ERROR));
+    }
+}
+
+void ProxyServer::linkReady(UpstreamLink* link) {
+    // Any link may carry a client's request, clients get what all of them speak
+    m_features = link->features();
+    for (const UpstreamLink* other : m_links) {
+        if (other->isReady()) {
+            m_features &= other->features();
+        }
+    }
+    m_featuresKnown = true;
+    ensureSubscription();
+}
+
+void ProxyServer::ensureSubscription() {
+    if (m_subscriptionLink || m_subscriptionRejected) {
+        return;
+    }
+    for (UpstreamLink* link : m_links) {
+        if (link->isReady()) {
+            m_subscriptionLink = link;
+            link->subscribe();
+            return;
+        }
+    }
+}
+
+void ProxyServer::linkSubscriptionChanged(UpstreamLink* link, bool active) {
+    if (link != m_subscriptionLink) {
+        return;
+    }
+
+    if (active) {
+        m_subscribed = true;
+        // Changes made while nobody listened are unknown
+        invalidateAll();
+        qInfo() << "Subscribed to change notifications";
+        return;
+    }
+
+    const bool wasSubscribed = m_subscribed;
+    m_subscriptionLink = nullptr;
+    m_subscribed = false;
+    if (link->isReady()) {
+        m_subscriptionRejected = true;
+        qInfo().noquote() << "Server has no change notifications, cached answers expire after"
+                          << m_options.unsubscribedTtlMs << "ms";
+        return;
+    }
+
+    if (wasSubscribed) {
+        invalidateAll();
+        // Their clients missed notifications, reconnecting makes them reload
+        for (const auto& session : m_sessions) {
+            if (session && session->isSubscribed()) {
+                session->close("Change notifications interrupted");
+            }
+        }
+    }
+    ensureSubscription();
+}
+
+void ProxyServer::linkNotification(UpstreamLink* link, const SharedMessage& message) {
+    if (link != m_subscriptionLink) {
+        return;
+    }
+
+    // Records use the plain encoding, see UpstreamLink
+    const std::vector<uint8_t> payload(message->begin() + 1, message->end());
+    try {
+        if ((*message)[0] == Protocol::NOTIFY_CHANGED) {
+            for (const CharacterData& character : CharacterData::deserializeVector(payload)) {
+                invalidateCharacter(character.id);
+            }
+        } else {
+            for (int32_t id : CharacterData::deserializeIds(payload)) {
+                invalidateCharacter(id);
+            }
+        }
+        invalidateRosters();
+    } catch (const std::exception&) {
+        invalidateAll();
+    }
+
+    for (const auto& session : m_sessions) {
+        if (session && session->isSubscribed()) {
+            session->notify(message);
+        }
+    }
+}
+
+ResponseCache& ProxyServer::cacheFor(uint8_t command) {
+    return command == Protocol::GET_ONE ? m_characters : m_rosters;
+}
+
+std::string ProxyServer::characterKey(int32_t id) {
+    std::string key(1 + sizeof(id), '\0');
+    key[0] = static_cast<char>(Protocol::GET_ONE);
+    std::memcpy(&key[1], &id, sizeof(id));
+    return key;
+}
+
+void ProxyServer::invalidateRosters() {
+    m_rosters.clear();
+    // Answers on their way may predate the change, later askers wait for fresh ones
+    for (auto it = m_inFlight.begin(); it != m_inFlight.end();) {
+        const uint8_t command = static_cast<uint8_t>(it->first[0]);
+        if (command != Protocol::GET_ONE) {
+            m_flights[it->second].stale = true;
+            it = m_inFlight.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void ProxyServer::invalidateCharacter(int32_t id) {
+    const std::string key = characterKey(id);
+    m_characters.remove(key);
+    auto flying = m_inFlight.find(key);
+    if (flying != m_inFlight.end()) {
+        m_flights[flying->second].stale = true;
+        m_inFlight.erase(flying);
+    }
+}
+
+void ProxyServer::invalidateAll() {
+    m_rosters.clear();
+    m_characters.clear();
+    for (const auto& flying : m_inFlight) {
+        m_flights[flying.second].stale = true;
+    }
+    m_inFlight.clear();
+}
+
+void ProxyServer::invalidateMutation(const std::vector<uint8_t>& request) {
+    switch (request[0]) {
+    case Protocol::UPDATE_CHARACTER:
+    case Protocol::REMOVE_CHARACTER: {
+        // Both payloads start with the character ID
+        int32_t id = 0;
+        if (request.size() < 1 + sizeof(id)) {
+            invalidateAll();
+            return;
+        }
+        std::memcpy(&id, request.data() + 1, sizeof(id));
+        invalidateCharacter(id);
+        invalidateRosters();
+        break;
+    }
+    case Protocol::ADD_CHARACTER:
+    case Protocol::ADD_CHARACTERS:
+        invalidateRosters();
+        break;
+    default:
+        // Other commands change nothing
+        break;
+    }
+}
+
+void ProxyServer::slotLogStats() {
+    if (m_stats.hits == 0 && m_stats.coalesced == 0 && m_stats.forwarded == 0 && m_stats.failed == 0) {
+        return;
+    }
+    qInfo().noquote() << QString("%1 cache hits, %2 coalesced, %3 forwarded, %4 failed; "
+                                 "%5 rosters and %6 characters cached, %7 MiB")
+                         .arg(m_stats.hits).arg(m_stats.coalesced)
+                         .arg(m_stats.forwarded).arg(m_stats.failed)
+                         .arg(m_rosters.count()).arg(m_characters.count())
+                         .arg((m_rosters.bytes() + m_characters.bytes()) / (1024 * 1024));
+    m_stats = Stats();
+}
@@ -0,0 +1,238 @@
+/**
+ * \file proxy_server.h
+ * \brief Multiplexing proxy in front of the character server
+ */
+
+#ifndef PROXY_SERVER_H
+#define PROXY_SERVER_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QPointer>
+#include <QTcpServer>
+#include <QTimer>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "downstream_session.h"
+#include "response_cache.h"
+#include "upstream_link.h"
+
+/**
+ * \class ProxyServer
+ * \brief Serves many clients over a few server connections
+ *
+ * \details Speaks Protocol on both sides:
+ * - Requests of every client share a small pool of UpstreamLink, each
+ *   request goes to the link with the fewest outstanding
+ * - GET_ALL, GET_ALL_COLUMNAR, QUERY, STATS and GET_ONE answers are
+ *   cached and served to any client asking the same
+ * - Identical reads already on their way to the server are not sent
+ *   again, every asker gets the one answer
+ * - Reads lost with a link are sent again on another one
+ * - One link subscribes to change notifications, which invalidate the
+ *   cache and are passed on to subscribed clients
+ *
+ * Mutations invalidate what they touch as soon as they are answered, the
+ * notification may arrive later. Without a subscription, servers that
+ * predate push, cached answers expire after a short time instead.
+ */
+class ProxyServer : public QObject {
+    Q_OBJECT
+
+public:
+    /**
+     * \struct Options
+     * \brief Proxy configuration
+     */
+    struct Options {
+        quint16 listenPort = Protocol::PORT;        ///< Port clients connect to
+        QString upstreamHost;                       ///< Server hostname/IP address
+        quint16 upstreamPort = Protocol::PORT;      ///< Server port
+        int upstreamLinks = 4;                      ///< Server connections
+        size_t cacheBytes = 256u * 1024 * 1024;     ///< Total size of cached answers
+        qint64 unsubscribedTtlMs = 1000;            ///< Answer lifetime without notifications
+        uint32_t maxFrameSize = 256u * 1024 * 1024; ///< Largest accepted message
+    };
+
+    /**
+     * \brief Constructs a stopped proxy
+     * \param options Proxy configuration
+     * \param parent Optional QObject parent
+     */
+    explicit ProxyServer(const Options& options, QObject* parent = nullptr);
+
+    /**
+     * \brief Starts listening and connecting upstream
+     * \return bool False if the listen port is unavailable
+     */
+    bool start();
+
+private slots:
+    /**
+     * \brief Accepts waiting client connections
+     */
+    void slotNewConnection();
+
+    /**
+     * \brief Logs cache and traffic counters
+     */
+    void slotLogStats();
+
+private:
+    /**
+     * \struct Waiter
+     * \brief Client request waiting for an upstream answer
+     */
+    struct Waiter {
+        QPointer<DownstreamSession> session;    ///< Client, null once disconnected
+        quint64 slot = 0;                       ///< Client's answer slot
+    };
+
+    /**
+     * \struct Flight
+     * \brief Request on its way to the server
+     */
+    struct Flight {
+        std::vector<uint8_t> message;   ///< Request message, command byte first
+        std::vector<Waiter> waiters;    ///< Clients waiting for the answer
+        bool cacheable = false;         ///< Answer goes to the cache
+        bool stale = false;             ///< Invalidated while in flight, not cached
+        int attempts = 0;               ///< Times sent upstream
+    };
+
+    /**
+     * \struct Stats
+     * \brief Traffic counters since the last log line
+     */
+    struct Stats {
+        uint64_t hits = 0;              ///< Reads answered from the cache
+        uint64_t coalesced = 0;         ///< Reads joined to one in flight
+        uint64_t forwarded = 0;         ///< Requests sent upstream
+        uint64_t failed = 0;            ///< Requests answered with an error
+    };
+
+    /**
+     * \brief Narrows the features offered to clients, subscribes if
+     * nothing is subscribed yet
+     * \param link Link that has negotiated
+     *
+     * \note Clients already connected keep the features they negotiated
+     */
+    void linkReady(UpstreamLink* link);
+
+    /**
+     * \brief Sends lost reads again and fails lost mutations
+     * \param tags Requests that were never answered
+     */
+    void linkLost(const std::vector<quint64>& tags);
+
+    /**
+     * \brief Invalidates the cache and passes a notification on
+     * \param link Link the notification arrived on
+     * \param message Protocol::NOTIFY_CHANGED or Protocol::NOTIFY_REMOVED message
+     */
+    void linkNotification(UpstreamLink* link, const SharedMessage& message);
+
+    /**
+     * \brief Tracks the upstream subscription
+     * \param link Link the subscription changed on
+     * \param active True if notifications are delivered
+     */
+    void linkSubscriptionChanged(UpstreamLink* link, bool active);
+
+    /**
+     * \brief Handles one client request
+     * \param session Client
+     * \param slot Client's answer slot
+     * \param message Request message, command byte first
+     */
+    void handleRequest(DownstreamSession* session, quint64 slot, const std::vector<uint8_t>& message);
+
+    /**
+     * \brief Negotiates features with a client
+     * \param session Client
+     * \param slot Client's answer slot
+     * \param message HELLO message
+     */
+    void answerHello(DownstreamSession* session, quint64 slot, const std::vector<uint8_t>& message);
+
+    /**
+     * \brief Sends a flight to the least loaded ready link
+     * \param tag Flight tag
+     */
+    void dispatch(quint64 tag);
+
+    /**
+     * \brief Answers every waiter of a flight and forgets it
+     * \param tag Flight tag
+     * \param message Answer, command byte first
+     */
+    void complete(quint64 tag, const SharedMessage& message);
+
+    /**
+     * \brief Returns the cache answers to a command go to
+     * \param command Protocol command byte
+     * \return ResponseCache& Whole-roster or single-character cache
+     */
+    ResponseCache& cacheFor(uint8_t command);
+
+    /**
+     * \brief Drops every cached and in-flight answer covering the whole roster
+     */
+    void invalidateRosters();
+
+    /**
+     * \brief Drops the cached and in-flight answer for one character
+     * \param id Character ID
+     */
+    void invalidateCharacter(int32_t id);
+
+    /**
+     * \brief Drops everything cached
+     */
+    void invalidateAll();
+
+    /**
+     * \brief Invalidates what a successful mutation touched
+     * \param request Mutation message
+     */
+    void invalidateMutation(const std::vector<uint8_t>& request);
+
+    /**
+     * \brief Subscribes on a ready link unless a subscription is active
+     */
+    void ensureSubscription();
+
+    /**
+     * \brief Returns the key of a GET_ONE request
+     * \param id Character ID
+     * \return std::string Request message
+     */
+    static std::string characterKey(int32_t id);
+
+    /// Interval between counter log lines
+    static constexpr int STATS_INTERVAL_MS = 60'000;
+    /// Times a read is sent before its askers get an error
+    static constexpr int MAX_ATTEMPTS = 2;
+
+    Options m_options;                                  ///< Proxy configuration
+    QTcpServer* m_server;                               ///< Listening socket
+    std::vector<UpstreamLink*> m_links;                 ///< Server connections
+    std::vector<QPointer<DownstreamSession>> m_sessions; ///< Connected clients
+    std::unordered_map<quint64, Flight> m_flights;      ///< Requests on their way, by tag
+    std::unordered_map<std::string, quint64> m_inFlight; ///< Cacheable flights by request message
+    quint64 m_nextTag = 1;                              ///< Tag of the next flight
+    ResponseCache m_rosters;                            ///< Answers covering the whole roster
+    ResponseCache m_characters;                         ///< GET_ONE answers
+    UpstreamLink* m_subscriptionLink = nullptr;         ///< Link holding the subscription
+    bool m_subscribed = false;                          ///< Notifications keep the cache fresh
+    bool m_subscriptionRejected = false;                ///< Server has no push support
+    uint32_t m_features = 0;                            ///< Features common to the links ready at the last negotiation
+    bool m_featuresKnown = false;                       ///< A link has negotiated
+    QElapsedTimer m_clock;                              ///< Time base for cache ages
+    QTimer* m_statsTimer;                               ///< Drives slotLogStats()
+    Stats m_stats;                                      ///< Counters since the last log line
+};
+
+#endif // PROXY_SERVER_H
@@ -0,0 +1,54 @@
+#include "response_cache.h"
+
+ResponseCache::ResponseCache(size_t capacityBytes)
+    : m_capacity(capacityBytes)
+{
+}
+
+SharedMessage ResponseCache::find(const std::string& key, qint64 nowMs, qint64 maxAgeMs) {
+    auto found = m_index.find(key);
+    if (found == m_index.end()) {
+        return nullptr;
+    }
+
+    auto it = found->second;
+    if (maxAgeMs >= 0 && nowMs - it->storedAtMs > maxAgeMs) {
+        erase(it);
+        return nullptr;
+    }
+    m_entries.splice(m_entries.begin(), m_entries, it);
+    return it->message;
+}
+
+void ResponseCache::insert(const std::string& key, const SharedMessage& message, qint64 nowMs) {
+    remove(key);
+    if (!message || message->size() > m_capacity) {
+        return;
+    }
+
+    m_entries.push_front({key, message, nowMs});
+    m_index.emplace(key, m_entries.begin());
+    m_bytes += message->size();
+    while (m_bytes > m_capacity) {
+        erase(std::prev(m_entries.end()));
+    }
+}
+
+void ResponseCache::remove(const std::string& key) {
+    auto found = m_index.find(key);
+    if (found != m_index.end()) {
+        erase(found->second);
+    }
+}
+
+void ResponseCache::clear() {
+    m_entries.clear();
+    m_index.clear();
+    m_bytes = 0;
+}
+
+void ResponseCache::erase(std::list<Entry>::iterator it) {
+    m_bytes -= it->message->size();
+    m_index.erase(it->key);
+    m_entries.erase(it);
+}
@@ -0,0 +1,95 @@
+/**
+ * \file response_cache.h
+ * \brief Byte-bounded cache of server answers
+ */
+
+#ifndef RESPONSE_CACHE_H
+#define RESPONSE_CACHE_H
+
+#include <QtGlobal>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include "frame_buffer.h"
+
+/**
+ * \class ResponseCache
+ * \brief Least recently used answers, keyed by the request that produced them
+ *
+ * \details The key is the request message itself, command byte and
+ * payload, so every projection of GET_ALL is cached on its own. Entries
+ * are evicted oldest use first once their total size exceeds the
+ * capacity. An answer larger than the whole capacity is not cached.
+ */
+class ResponseCache {
+public:
+    /**
+     * \brief Constructs an empty cache
+     * \param capacityBytes Total size of the cached answers
+     */
+    explicit ResponseCache(size_t capacityBytes);
+
+    /**
+     * \brief Looks up an answer
+     * \param key Request message
+     * \param nowMs Current time
+     * \param maxAgeMs Older answers are dropped, negative for no limit
+     * \return SharedMessage The answer, null on a miss
+     */
+    SharedMessage find(const std::string& key, qint64 nowMs, qint64 maxAgeMs);
+
+    /**
+     * \brief Stores an answer, replacing any previous one
+     * \param key Request message
+     * \param message Answer to store
+     * \param nowMs Current time
+     */
+    void insert(const std::string& key, const SharedMessage& message, qint64 nowMs);
+
+    /**
+     * \brief Drops one answer
+     * \param key Request message
+     */
+    void remove(const std::string& key);
+
+    /**
+     * \brief Drops every answer
+     */
+    void clear();
+
+    /**
+     * \brief Returns the number of cached answers
+     * \return size_t Entry count
+     */
+    size_t count() const { return m_index.size(); }
+
+    /**
+     * \brief Returns the size of the cached answers
+     * \return size_t Bytes
+     */
+    size_t bytes() const { return m_bytes; }
+
+private:
+    /**
+     * \struct Entry
+     * \brief Cached answer
+     */
+    struct Entry {
+        std::string key;            ///< Request message
+        SharedMessage message;      ///< Answer
+        qint64 storedAtMs = 0;      ///< Time the answer was stored
+    };
+
+    /**
+     * \brief Drops an entry
+     * \param it Entry position in the use order
+     */
+    void erase(std::list<Entry>::iterator it);
+
+    std::list<Entry> m_entries;     ///< Entries, most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> m_index;  ///< Entries by key
+    size_t m_bytes = 0;             ///< Size of the cached answers
+    size_t m_capacity;              ///< Largest total size
+};
+
+#endif // RESPONSE_CACHE_H
@@ -0,0 +1,185 @@
+#include "upstream_link.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+UpstreamLink::UpstreamLink(const QString& host, quint16 port, uint32_t maxFrameSize, QObject* parent)
+    : QObject(parent), m_host(host), m_port(port),
+      m_socket(new QTcpSocket(this)), m_reconnectTimer(new QTimer(this)),
+      m_buffer(maxFrameSize)
+{
+    connect(m_socket, &QTcpSocket::connected, this, &UpstreamLink::slotConnected);
+    connect(m_socket, &QTcpSocket::disconnected, this, &UpstreamLink::slotDisconnected);
+    connect(m_socket, &QTcpSocket::readyRead, this, &UpstreamLink::slotReadyRead);
+    connect(m_socket, QOverload<QAbstractSocket::SocketError>::of(&QAbstractSocket::errorOccurred),
+            this, &UpstreamLink::slotError);
+
+    m_reconnectTimer->setSingleShot(true);
+    connect(m_reconnectTimer, &QTimer::timeout, this, &UpstreamLink::slotReconnect);
+}
+
+UpstreamLink::~UpstreamLink() {
+    m_open = false;
+    m_socket->disconnectFromHost();
+}
+
+void UpstreamLink::open() {
+    m_open = true;
+    slotReconnect();
+}
+
+void UpstreamLink::close() {
+    m_open = false;
+    m_reconnectTimer->stop();
+    m_socket->disconnectFromHost();
+}
+
+void UpstreamLink::slotReconnect() {
+    if (m_open && m_socket->state() == QAbstractSocket::UnconnectedState) {
+        m_socket->connectToHost(m_host, m_port);
+    }
+}
+
+void UpstreamLink::scheduleReconnect() {
+    if (!m_open || m_reconnectTimer->isActive()) {
+        return;
+    }
+    m_reconnectTimer->start(m_reconnectDelayMs);
+    m_reconnectDelayMs = std::min(m_reconnectDelayMs * 2, RECONNECT_MAX_MS);
+}
+
+void UpstreamLink::send(quint64 tag, const std::vector<uint8_t>& message) {
+    Pending pending;
+    pending.tag = tag;
+    write(pending, message);
+}
+
+void UpstreamLink::subscribe() {
+    Pending pending;
+    pending.kind = Pending::Kind::Subscribe;
+    write(pending, {Protocol::SUBSCRIBE});
+}
+
+void UpstreamLink::write(const Pending& pending, const std::vector<uint8_t>& message) {
+    FrameBuffer::write(m_socket, message, m_buffer.framed());
+    m_pending.push_back(pending);
+}
+
+void UpstreamLink::slotConnected() {
+    m_ready = false;
+    m_subscribed = false;
+    m_features = 0;
+    m_buffer.clear();
+    m_pending.clear();
+
+    // Offer what the proxy can pass through unchanged, the server picks
+    std::vector<uint8_t> hello(1 + sizeof(OFFERED_FEATURES));
+    hello[0] = Protocol::HELLO;
+    const uint32_t offered = OFFERED_FEATURES;
+    std::memcpy(hello.data() + 1, &offered, sizeof(offered));
+    Pending pending;
+    pending.kind = Pending::Kind::Hello;
+    write(pending, hello);
+}
+
+void UpstreamLink::slotDisconnected() {
+    // A subscription still awaiting its answer is lost as well
+    bool wasSubscribed = m_subscribed;
+    m_ready = false;
+    m_subscribed = false;
+    m_features = 0;
+    m_buffer.clear();
+
+    std::vector<quint64> lost;
+    lost.reserve(m_pending.size());
+    for (const auto& pending : m_pending) {
+        if (pending.kind == Pending::Kind::Forwarded) {
+            lost.push_back(pending.tag);
+        } else if (pending.kind == Pending::Kind::Subscribe) {
+            wasSubscribed = true;
+        }
+    }
+    m_pending.clear();
+
+    if (wasSubscribed) {
+        emit signalSubscriptionChanged(false);
+    }
+    emit signalLost(lost);
+    scheduleReconnect();
+}
+
+void UpstreamLink::slotReadyRead() {
+    std::vector<uint8_t> message;
+    while (m_socket->bytesAvailable() > 0) {
+        const QByteArray data = m_socket->read(READ_CHUNK_SIZE);
+        m_buffer.append(data.constData(), static_cast<size_t>(data.size()));
+
+        // Framing is re-checked per message as HELLO may switch it
+        try {
+            while (m_socket->state() == QAbstractSocket::ConnectedState && m_buffer.next(message)) {
+                processMessage(message);
+            }
+        } catch (const std::length_error& e) {
+            failProtocol(e.what());
+            return;
+        }
+        if (m_socket->state() != QAbstractSocket::ConnectedState) {
+            return;
+        }
+    }
+}
+
+void UpstreamLink::processMessage(std::vector<uint8_t>& message) {
+    if (message.empty()) {
+        failProtocol("Empty message");
+        return;
+    }
+
+    // Notifications are the only messages that do not answer a request
+    const uint8_t command = message[0];
+    if (command == Protocol::NOTIFY_CHANGED || command == Protocol::NOTIFY_REMOVED) {
+        emit signalNotification(std::make_shared<const std::vector<uint8_t>>(std::move(message)));
+        return;
+    }
+    if (m_pending.empty()) {
+        failProtocol("Unexpected message");
+        return;
+    }
+
+    const Pending pending = m_pending.front();
+    m_pending.pop_front();
+    switch (pending.kind) {
+    case Pending::Kind::Hello: {
+        m_features = Protocol::acceptedFeatures(message, OFFERED_FEATURES);
+        m_buffer.setFramed(m_features & Protocol::FEATURE_LENGTH_FRAMED);
+        m_ready = true;
+        m_reconnectDelayMs = RECONNECT_MIN_MS;
+        emit signalReady();
+        break;
+    }
+    case Pending::Kind::Subscribe:
+        // Servers without push support reject it
+        m_subscribed = command == Protocol::SUBSCRIBE;
+        emit signalSubscriptionChanged(m_subscribed);
+        break;
+    case Pending::Kind::Forwarded:
+        emit signalAnswered(pending.tag, std::make_shared<const std::vector<uint8_t>>(std::move(message)));
+        break;
+    }
+}
+
+void UpstreamLink::failProtocol(const QString& message) {
+    emit signalConnectionFailed("Protocol error: " + message);
+    // Emits disconnected, which hands everything pending back
+    m_socket->abort();
+}
+
+void UpstreamLink::slotError(QAbstractSocket::SocketError error) {
+    Q_UNUSED(error)
+    emit signalConnectionFailed(m_socket->errorString());
+    // Failed attempts never emit disconnected
+    if (m_socket->state() != QAbstractSocket::ConnectedState) {
+        scheduleReconnect();
+    }
+}
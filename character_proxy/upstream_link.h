@@ -0,0 +1,232 @@
+/**
+ * \file upstream_link.h
+ * \brief Proxy connection to the character server
+ */
+
+#ifndef UPSTREAM_LINK_H
+#define UPSTREAM_LINK_H
+
+#include <QObject>
+#include <QTcpSocket>
+#include <QTimer>
+#include <deque>
+#include <vector>
+#include "frame_buffer.h"
+#include "protocol.h"
+
+/**
+ * \class UpstreamLink
+ * \brief Carries requests of many proxy clients to the server
+ *
+ * \details Messages are forwarded as they are, the link only adds the
+ * framing it negotiated and matches answers to requests by order. Each
+ * request carries a tag chosen by the owner and handed back with its
+ * answer. The link reconnects with backoff until close().
+ *
+ * Records are kept in the plain encoding, Protocol::FEATURE_VARINT_ENCODING
+ * is never offered, so one cached answer suits every proxy client.
+ */
+class UpstreamLink : public QObject {
+    Q_OBJECT
+
+public:
+    /**
+     * \brief Constructs a link, call open() to connect
+     * \param host Server hostname/IP address
+     * \param port Server port
+     * \param maxFrameSize Largest accepted answer
+     * \param parent Optional QObject parent
+     */
+    UpstreamLink(const QString& host, quint16 port, uint32_t maxFrameSize, QObject* parent = nullptr);
+
+    /**
+     * \brief Destructor - ensures proper socket cleanup
+     */
+    ~UpstreamLink();
+
+    /**
+     * \brief Connects, and keeps reconnecting with backoff until close()
+     */
+    void open();
+
+    /**
+     * \brief Disconnects and stops reconnecting
+     */
+    void close();
+
+    /**
+     * \brief Returns whether the link is connected and negotiated
+     * \return bool True if requests can be sent
+     */
+    bool isReady() const { return m_ready; }
+
+    /**
+     * \brief Returns protocol features negotiated with the server
+     * \return uint32_t Mask of Protocol::FEATURE_* flags
+     */
+    uint32_t features() const { return m_features; }
+
+    /**
+     * \brief Returns the number of requests awaiting an answer
+     * \return size_t Pending request count
+     */
+    size_t pendingCount() const { return m_pending.size(); }
+
+    /**
+     * \brief Returns whether change notifications are active
+     * \return bool True if the server accepted the subscription
+     */
+    bool isSubscribed() const { return m_subscribed; }
+
+    /**
+     * \brief Forwards a request
+     * \param tag Owner's request tag, handed back with the answer
+     * \param message Request message, command byte first
+     *
+     * \note Only valid while isReady()
+     */
+    void send(quint64 tag, const std::vector<uint8_t>& message);
+
+    /**
+     * \brief Subscribes to server-pushed change notifications
+     *
+     * \note Answered with signalSubscriptionChanged()
+     */
+    void subscribe();
+
+    /// Protocol::FEATURE_* flags offered in HELLO
+    static constexpr uint32_t OFFERED_FEATURES =
+            Protocol::FEATURE_LENGTH_FRAMED | Protocol::FEATURE_COLUMNAR |
+            Protocol::FEATURE_PROJECTION | Protocol::FEATURE_BATCH_ADD |
+            Protocol::FEATURE_STATS | Protocol::FEATURE_QUERY;
+
+signals:
+    /**
+     * \brief Emitted when the link is connected and negotiated
+     */
+    void signalReady();
+
+    /**
+     * \brief Emitted when a connection attempt or the connection fails
+     * \param error Error description
+     */
+    void signalConnectionFailed(const QString& error);
+
+    /**
+     * \brief Emitted when the answer to a request has arrived whole
+     * \param tag Request tag passed to send()
+     * \param message Answer, command byte first
+     */
+    void signalAnswered(quint64 tag, const SharedMessage& message);
+
+    /**
+     * \brief Emitted when the connection is lost
+     * \param tags Requests that were sent and never answered, oldest first
+     */
+    void signalLost(const std::vector<quint64>& tags);
+
+    /**
+     * \brief Emitted for every change notification pushed by the server
+     * \param message Protocol::NOTIFY_CHANGED or Protocol::NOTIFY_REMOVED message
+     */
+    void signalNotification(const SharedMessage& message);
+
+    /**
+     * \brief Emitted when the subscription is accepted, rejected or lost
+     * \param active True if notifications are delivered
+     *
+     * \note Emitted with false for a subscription lost before its answer
+     */
+    void signalSubscriptionChanged(bool active);
+
+private slots:
+    /**
+     * \brief Negotiates features on a fresh connection
+     */
+    void slotConnected();
+
+    /**
+     * \brief Hands pending requests back and schedules a reconnect
+     */
+    void slotDisconnected();
+
+    /**
+     * \brief Processes incoming data from server
+     */
+    void slotReadyRead();
+
+    /**
+     * \brief Handles socket errors
+     * \param error Error code
+     */
+    void slotError(QAbstractSocket::SocketError error);
+
+    /**
+     * \brief Starts a connection attempt if the link is still open
+     */
+    void slotReconnect();
+
+private:
+    /**
+     * \struct Pending
+     * \brief Request sent to the server and not answered yet
+     */
+    struct Pending {
+        /**
+         * \brief Who the answer belongs to
+         */
+        enum class Kind {
+            Hello,          ///< The link's own feature negotiation
+            Subscribe,      ///< The link's own subscription
+            Forwarded       ///< Owner's request
+        };
+
+        Kind kind = Kind::Forwarded;    ///< Who the answer belongs to
+        quint64 tag = 0;                ///< Owner's request tag
+    };
+
+    /**
+     * \brief Writes a request and tracks it until answered
+     * \param pending Request bookkeeping
+     * \param message Request message, command byte first
+     */
+    void write(const Pending& pending, const std::vector<uint8_t>& message);
+
+    /**
+     * \brief Processes one message from the server
+     * \param message Message without framing
+     */
+    void processMessage(std::vector<uint8_t>& message);
+
+    /**
+     * \brief Schedules the next connection attempt with exponential backoff
+     */
+    void scheduleReconnect();
+
+    /**
+     * \brief Drops the connection after a protocol violation
+     * \param message Error description
+     */
+    void failProtocol(const QString& message);
+
+    /// First reconnect delay, doubled per failed attempt
+    static constexpr int RECONNECT_MIN_MS = 500;
+    /// Longest reconnect delay
+    static constexpr int RECONNECT_MAX_MS = 30'000;
+    /// Bytes taken from the socket per read
+    static constexpr qint64 READ_CHUNK_SIZE = 256 * 1024;
+
+    QString m_host;                           ///< Server hostname/IP address
+    quint16 m_port;                           ///< Server port
+    QTcpSocket* m_socket;                     ///< TCP socket instance
+    QTimer* m_reconnectTimer;                 ///< Delays the next connection attempt
+    int m_reconnectDelayMs = RECONNECT_MIN_MS; ///< Delay before the next attempt
+    bool m_open = false;                      ///< Connection is wanted, reconnect when lost
+    bool m_ready = false;                     ///< Connected and negotiated
+    bool m_subscribed = false;                ///< Change notifications are active
+    uint32_t m_features = 0;                  ///< Negotiated Protocol::FEATURE_* flags
+    FrameBuffer m_buffer;                     ///< Received bytes
+    std::deque<Pending> m_pending;            ///< Requests awaiting a response, oldest first
+};
+
+#endif // UPSTREAM_LINK_H
@@ -0,0 +1,298 @@
+/**
+ * \file main.cpp
+ * \brief Unit test of the protocol codecs
+ *
+ * \details Round trips every encoding of protocol.h: varints, compact
+ * records with zigzag ids, plain and compact rosters, columnar row
+ * groups, statistics and queries. Every proper prefix of an encoding has
+ * to throw std::out_of_range, and so do counts announcing more than the
+ * data holds, before anything is allocated for them.
+ *
+ * Plain C++, protocol.cpp needs no Qt.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "protocol.h"
+
+namespace {
+
+void check(bool condition, const char* what) {
+    if (!condition) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        std::exit(1);
+    }
+}
+
+// Runs a decoder and reports whether it threw std::out_of_range
+bool throwsOutOfRange(const std::function<void()>& decode) {
+    try {
+        decode();
+    } catch (const std::out_of_range&) {
+        return true;
+    }
+    return false;
+}
+
+// Every proper prefix of an encoding is truncated and has to throw
+void checkTruncation(const std::vector<uint8_t>& data,
+                     const std::function<void(const std::vector<uint8_t>&)>& decode, const char* what) {
+    for (size_t size = 0; size < data.size(); ++size) {
+        const std::vector<uint8_t> prefix(data.begin(), data.begin() + static_cast<std::ptrdiff_t>(size));
+        check(throwsOutOfRange([&]() { decode(prefix); }), what);
+    }
+}
+
+bool sameCharacter(const CharacterData& a, const CharacterData& b) {
+    return a.id == b.id && a.age == b.age && a.name == b.name && a.surname == b.surname && a.bio == b.bio;
+}
+
+bool sameRoster(const std::vector<CharacterData>& a, const std::vector<CharacterData>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (!sameCharacter(a[i], b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+CharacterData makeCharacter(int32_t id, uint8_t age, const std::string& name,
+                            const std::string& surname, const std::string& bio) {
+    CharacterData character;
+    character.id = id;
+    character.age = age;
+    character.name = name;
+    character.surname = surname;
+    character.bio = bio;
+    return character;
+}
+
+// Edge values in every field, repeated names for the dictionaries
+std::vector<CharacterData> makeRoster() {
+    std::vector<CharacterData> roster = {
+        makeCharacter(0, 0, "", "", ""),
+        makeCharacter(-1, 255, "Ann", "Lee", "short"),
+        makeCharacter(std::numeric_limits<int32_t>::min(), 42, "Ann", "Lee", std::string(300, 'x')),
+        makeCharacter(std::numeric_limits<int32_t>::max(), 17, "Борис", "Ёлкин", "многобайтовая биография"),
+    };
+    for (int32_t id = 1; id <= 6; ++id) {
+        roster.push_back(makeCharacter(id * 1000, static_cast<uint8_t>(id), "Ann", "Lee" + std::to_string(id % 2), ""));
+    }
+    return roster;
+}
+
+std::vector<uint8_t> varintOf(uint32_t value) {
+    std::vector<uint8_t> buffer;
+    CharacterData::write_varint(buffer, value);
+    return buffer;
+}
+
+void testVarint() {
+    const struct {
+        uint32_t value;
+        size_t size;
+    } cases[] = {
+        {0, 1}, {1, 1}, {127, 1}, {128, 2}, {16383, 2}, {16384, 3},
+        {(1u << 21) - 1, 3}, {1u << 21, 4}, {1u << 28, 5}, {std::numeric_limits<uint32_t>::max(), 5},
+    };
+    for (const auto& c : cases) {
+        const std::vector<uint8_t> buffer = varintOf(c.value);
+        check(buffer.size() == c.size, "varint takes the expected bytes");
+        size_t offset = 0;
+        check(CharacterData::read_varint(buffer, offset) == c.value, "varint round trip");
+        check(offset == buffer.size(), "varint read consumes its bytes");
+        checkTruncation(buffer, [](const std::vector<uint8_t>& data) {
+            size_t offset = 0;
+            CharacterData::read_varint(data, offset);
+        }, "truncated varint throws");
+    }
+
+    const std::vector<uint8_t> overlong = {0x80, 0x80, 0x80, 0x80, 0x80, 0x01};
+    check(throwsOutOfRange([&]() {
+        size_t offset = 0;
+        CharacterData::read_varint(overlong, offset);
+    }), "varint longer than 5 bytes throws");
+}
+
+void testCompactRecord() {
+    for (const CharacterData& character : makeRoster()) {
+        const std::vector<uint8_t> data = character.serializeCompact();
+        check(sameCharacter(CharacterData::deserializeCompact(data), character), "compact record round trip");
+        checkTruncation(data, [](const std::vector<uint8_t>& prefix) {
+            CharacterData::deserializeCompact(prefix);
+        }, "truncated compact record throws");
+    }
+
+    // Zigzag keeps small negative ids as short as small positive ones
+    check(makeCharacter(-1, 0, "", "", "").serializeCompact().size()
+          == makeCharacter(1, 0, "", "", "").serializeCompact().size(), "zigzag encodes -1 as short as 1");
+}
+
+void testRosters() {
+    const std::vector<CharacterData> roster = makeRoster();
+
+    const std::vector<uint8_t> plain = CharacterData::serializeVector(roster);
+    check(sameRoster(CharacterData::deserializeVector(plain), roster), "plain roster round trip");
+    checkTruncation(plain, [](const std::vector<uint8_t>& prefix) {
+        CharacterData::deserializeVector(prefix);
+    }, "truncated plain roster throws");
+
+    const std::vector<uint8_t> compact = CharacterData::serializeVectorCompact(roster);
+    check(sameRoster(CharacterData::deserializeVectorCompact(compact), roster), "compact roster round trip");
+    checkTruncation(compact, [](const std::vector<uint8_t>& prefix) {
+        CharacterData::deserializeVectorCompact(prefix);
+    }, "truncated compact roster throws");
+    check(CharacterData::deserializeVectorCompact(CharacterData::serializeVectorCompact({})).empty(),
+          "empty compact roster round trip");
+
+    // A few bytes announcing four billion records
+    std::vector<uint8_t> oversized(sizeof(uint32_t), 0xFF);
+    check(throwsOutOfRange([&]() { CharacterData::deserializeVector(oversized); }),
+          "oversized plain count throws");
+    oversized = varintOf(std::numeric_limits<uint32_t>::max());
+    check(throwsOutOfRange([&]() { CharacterData::deserializeVectorCompact(oversized); }),
+          "oversized compact count throws");
+
+    const std::vector<int32_t> ids = {0, -5, 7, std::numeric_limits<int32_t>::max()};
+    const std::vector<uint8_t> idData = CharacterData::serializeIds(ids);
+    check(CharacterData::deserializeIds(idData) == ids, "id list round trip");
+    checkTruncation(idData, [](const std::vector<uint8_t>& prefix) {
+        CharacterData::deserializeIds(prefix);
+    }, "truncated id list throws");
+}
+
+void testColumnar() {
+    const std::vector<CharacterData> roster = makeRoster();
+    CharacterColumns columns;
+    for (const CharacterData& character : roster) {
+        columns.append(character);
+    }
+
+    // Groups of three, the last one partly filled
+    const std::vector<uint8_t> data = columns.serialize(3);
+    const CharacterColumns decoded = CharacterColumns::deserialize(data);
+    check(decoded.size() == roster.size(), "columnar row count");
+    for (size_t row = 0; row < roster.size(); ++row) {
+        check(sameCharacter(decoded.row(row), roster[row]), "columnar round trip");
+    }
+    checkTruncation(data, [](const std::vector<uint8_t>& prefix) {
+        CharacterColumns::deserialize(prefix);
+    }, "truncated columnar roster throws");
+
+    // groupSize() spans exactly what readGroup() consumes, and is 0 until then
+    size_t offset = 0;
+    size_t groups = 0;
+    while (true) {
+        const size_t size = CharacterColumns::groupSize(data, offset);
+        check(size != 0, "complete group is measured");
+        const std::vector<uint8_t> partial(data.begin(), data.begin() + static_cast<std::ptrdiff_t>(offset + size - 1));
+        check(CharacterColumns::groupSize(partial, offset) == 0, "incomplete group measures 0");
+
+        CharacterColumns group;
+        const size_t start = offset;
+        const size_t rows = group.readGroup(data, offset);
+        check(offset - start == size, "groupSize matches the bytes read");
+        if (rows == 0) {
+            break;
+        }
+        ++groups;
+    }
+    check(groups == 4 && offset == data.size(), "ten rows make four groups and a terminator");
+
+    // Four billion rows announced by a group of a few bytes
+    std::vector<uint8_t> oversized = data;
+    const uint32_t rows = std::numeric_limits<uint32_t>::max();
+    std::memcpy(oversized.data(), &rows, sizeof(rows));
+    check(throwsOutOfRange([&]() { CharacterColumns::deserialize(oversized); }), "oversized row count throws");
+
+    // Dictionary size of the first name column, right after ids and ages
+    oversized = data;
+    const size_t dictionaryAt = sizeof(uint32_t) + 3 * (sizeof(int32_t) + sizeof(uint8_t));
+    const uint32_t entries = std::numeric_limits<uint32_t>::max();
+    std::memcpy(oversized.data() + dictionaryAt, &entries, sizeof(entries));
+    check(throwsOutOfRange([&]() { CharacterColumns::deserialize(oversized); }), "oversized dictionary throws");
+}
+
+void testStats() {
+    CharacterStats stats;
+    stats.count = 1000000;
+    stats.ageHistogram = {{0, 1}, {18, 400000}, {255, 599999}};
+    stats.distinctSurnames = 70000;
+    stats.topSurnames = {{"Lee", 5000}, {"Ёлкин", 4000}, {"", 1}};
+
+    const std::vector<uint8_t> data = stats.serialize();
+    const CharacterStats decoded = CharacterStats::deserialize(data);
+    check(decoded.count == stats.count && decoded.ageHistogram == stats.ageHistogram
+          && decoded.distinctSurnames == stats.distinctSurnames && decoded.topSurnames == stats.topSurnames,
+          "stats round trip");
+    checkTruncation(data, [](const std::vector<uint8_t>& prefix) {
+        CharacterStats::deserialize(prefix);
+    }, "truncated stats throw");
+
+    // Count, more buckets than there are ages
+    std::vector<uint8_t> oversized = varintOf(1);
+    CharacterData::write_varint(oversized, 257);
+    check(throwsOutOfRange([&]() { CharacterStats::deserialize(oversized); }), "oversized bucket count throws");
+
+    // Count, no buckets, distinct surnames, then far too many surnames
+    oversized = varintOf(1);
+    CharacterData::write_varint(oversized, 0);
+    CharacterData::write_varint(oversized, 1);
+    CharacterData::write_varint(oversized, std::numeric_limits<uint32_t>::max());
+    check(throwsOutOfRange([&]() { CharacterStats::deserialize(oversized); }), "oversized surname count throws");
+}
+
+void testQuery() {
+    std::vector<uint8_t> data;
+    CharacterQuery().write(data);
+    size_t offset = 0;
+    check(CharacterQuery::read(data, offset).isEmpty() && offset == data.size(), "empty query round trip");
+
+    CharacterQuery query;
+    query.minAge = 20;
+    query.maxAge = 30;
+    query.namePrefix = "an";
+    query.surnamePrefix = "Ё";
+    query.bioSubstring = "DRAGON";
+    query.limit = 300;
+    data.clear();
+    query.write(data);
+    offset = 0;
+    const CharacterQuery decoded = CharacterQuery::read(data, offset);
+    check(offset == data.size(), "query read consumes its bytes");
+    check(decoded.minAge == 20 && decoded.maxAge == 30 && decoded.namePrefix == "an"
+          && decoded.surnamePrefix == "Ё" && decoded.bioSubstring == "DRAGON" && decoded.limit == 300,
+          "query round trip");
+    checkTruncation(data, [](const std::vector<uint8_t>& prefix) {
+        size_t offset = 0;
+        CharacterQuery::read(prefix, offset);
+    }, "truncated query throws");
+
+    check(decoded.matches(makeCharacter(1, 25, "Anna", "Ёлкин", "slew a dragon once")), "query matches");
+    check(!decoded.matches(makeCharacter(1, 31, "Anna", "Ёлкин", "slew a dragon once")), "age outside the range");
+    check(!decoded.matches(makeCharacter(1, 25, "Bea", "Ёлкин", "slew a dragon once")), "name prefix differs");
+}
+
+}
+
+int main() {
+    testVarint();
+    testCompactRecord();
+    testRosters();
+    testColumnar();
+    testStats();
+    testQuery();
+    std::printf("protocol_codecs: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,16 @@
+# Unit test of the protocol codecs, plain C++ without Qt.
+# Exits with a non-zero status on the first failed check, see main.cpp.
+
+CONFIG += c++17 console
+CONFIG -= app_bundle qt
+
+TARGET = protocol_codecs_test
+
+INCLUDEPATH += ../../character_client
+
+SOURCES += \
+    main.cpp \
+    ../../character_client/protocol.cpp
+
+HEADERS += \
+    ../../character_client/protocol.h
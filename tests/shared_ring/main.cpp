@@ -0,0 +1,221 @@
+/**
+ * \file main.cpp
+ * \brief Unit test of SharedRing
+ *
+ * \details Covers an empty and a full ring, data wrapping around the end
+ * of the data area, the wait flags both sides raise before sleeping, and
+ * a writer and a reader thread streaming through a small ring with a
+ * condition variable standing in for the doorbell.
+ *
+ * Plain C++, both views live in one process over the same memory.
+ */
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "shared_ring.h"
+
+namespace {
+
+// Small enough that the stream wraps and fills the ring many times
+constexpr uint32_t CAPACITY = 64;
+// Bytes streamed between the two threads
+constexpr size_t STREAM_BYTES = 1u << 20;
+
+void check(bool condition, const char* what) {
+    if (!condition) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        std::exit(1);
+    }
+}
+
+// Control block and data area as they would sit in a segment
+struct Memory {
+    alignas(64) uint8_t bytes[sizeof(SharedRing::Control) + CAPACITY];
+
+    Memory() { new (bytes) SharedRing::Control(); }
+
+    SharedRing view() {
+        return SharedRing(reinterpret_cast<SharedRing::Control*>(bytes),
+                          bytes + sizeof(SharedRing::Control), CAPACITY);
+    }
+};
+
+// Pattern byte at a stream position
+uint8_t pattern(size_t position) {
+    return static_cast<uint8_t>(position * 7 + 3);
+}
+
+// One wakeup per ring(), like a byte on the doorbell socket
+class Doorbell {
+public:
+    void ring() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_rings;
+        m_rung.notify_one();
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_rung.wait(lock, [this]() { return m_rings > 0; });
+        m_rings = 0;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_rung;
+    int m_rings = 0;
+};
+
+void testEmptyAndFull() {
+    Memory memory;
+    SharedRing writer = memory.view();
+    SharedRing reader = memory.view();
+    writer.reset();
+
+    uint8_t out[CAPACITY] = {};
+    check(reader.available() == 0, "new ring is empty");
+    check(reader.read(out, sizeof(out)) == 0, "reading an empty ring returns nothing");
+    check(writer.space() == CAPACITY, "new ring has full capacity");
+
+    std::vector<uint8_t> in(CAPACITY + 10, 0x5A);
+    check(writer.write(in.data(), in.size()) == CAPACITY, "write stops at capacity");
+    check(writer.space() == 0, "full ring has no space");
+    check(writer.write(in.data(), 1) == 0, "writing a full ring returns nothing");
+    check(reader.available() == CAPACITY, "reader sees the whole ring");
+
+    check(reader.read(out, 10) == 10, "partial read");
+    check(writer.space() == 10, "read frees space");
+    check(reader.read(out, sizeof(out)) == CAPACITY - 10, "read drains the rest");
+    check(reader.available() == 0, "drained ring is empty");
+}
+
+void testWraparound() {
+    Memory memory;
+    SharedRing writer = memory.view();
+    SharedRing reader = memory.view();
+    writer.reset();
+
+    // Moves both indices close to the end of the data area
+    std::vector<uint8_t> in(CAPACITY - 5);
+    std::vector<uint8_t> out(CAPACITY);
+    check(writer.write(in.data(), in.size()) == in.size(), "fill up to the end");
+    check(reader.read(out.data(), out.size()) == in.size(), "drain up to the end");
+
+    // Crosses the end, lands at the start of the area
+    std::vector<uint8_t> wrapped(CAPACITY - 1);
+    for (size_t i = 0; i < wrapped.size(); ++i) {
+        wrapped[i] = pattern(i);
+    }
+    check(writer.write(wrapped.data(), wrapped.size()) == wrapped.size(), "write across the end");
+    check(reader.available() == wrapped.size(), "wrapped bytes are available");
+    check(reader.read(out.data(), wrapped.size()) == wrapped.size(), "read across the end");
+    check(std::equal(wrapped.begin(), wrapped.end(), out.begin()), "bytes survive the wraparound");
+}
+
+void testWakeupHandshake() {
+    Memory memory;
+    SharedRing writer = memory.view();
+    SharedRing reader = memory.view();
+    writer.reset();
+
+    const uint8_t byte = 1;
+    uint8_t out[CAPACITY] = {};
+
+    // The reader starts out waiting, the first write wakes it once
+    check(writer.write(&byte, 1) == 1, "first write");
+    check(writer.takeReaderWakeup(), "first write wakes the reader");
+    check(!writer.takeReaderWakeup(), "the flag is taken only once");
+    check(writer.write(&byte, 1) == 1, "second write");
+    check(!writer.takeReaderWakeup(), "a busy reader is not woken");
+
+    // Data arrived before the reader slept, it must not wait
+    check(!reader.waitForData(), "no wait while data is available");
+    check(!writer.takeReaderWakeup(), "withdrawn wait needs no wakeup");
+    check(reader.read(out, sizeof(out)) == 2, "drain");
+    check(reader.waitForData(), "empty ring makes the reader wait");
+    check(writer.write(&byte, 1) == 1, "write to a waiting reader");
+    check(writer.takeReaderWakeup(), "waiting reader is woken");
+
+    // Same on the writer side
+    std::vector<uint8_t> in(CAPACITY);
+    check(writer.write(in.data(), in.size()) == CAPACITY - 1, "fill the ring");
+    check(!reader.takeWriterWakeup(), "a busy writer is not woken");
+    check(writer.waitForSpace(), "full ring makes the writer wait");
+    check(reader.read(out, 1) == 1, "free one byte");
+    check(reader.takeWriterWakeup(), "waiting writer is woken");
+    check(!reader.takeWriterWakeup(), "the writer flag is taken only once");
+    check(!writer.waitForSpace(), "no wait while space is free");
+    check(!reader.takeWriterWakeup(), "withdrawn writer wait needs no wakeup");
+}
+
+void testStream() {
+    Memory memory;
+    SharedRing writer = memory.view();
+    SharedRing reader = memory.view();
+    writer.reset();
+    Doorbell toReader;
+    Doorbell toWriter;
+
+    // Chunk sizes prime to the capacity, so every offset gets crossed
+    std::thread producer([&]() {
+        uint8_t chunk[37];
+        size_t sent = 0;
+        while (sent < STREAM_BYTES) {
+            const size_t size = std::min(sizeof(chunk), STREAM_BYTES - sent);
+            for (size_t i = 0; i < size; ++i) {
+                chunk[i] = pattern(sent + i);
+            }
+            size_t done = 0;
+            while (done < size) {
+                const size_t written = writer.write(chunk + done, size - done);
+                done += written;
+                if (written > 0 && writer.takeReaderWakeup()) {
+                    toReader.ring();
+                }
+                if (written == 0 && writer.waitForSpace()) {
+                    toWriter.wait();
+                }
+            }
+            sent += size;
+        }
+    });
+
+    uint8_t chunk[29];
+    size_t received = 0;
+    bool intact = true;
+    while (received < STREAM_BYTES) {
+        const size_t size = reader.read(chunk, sizeof(chunk));
+        for (size_t i = 0; i < size; ++i) {
+            intact = intact && chunk[i] == pattern(received + i);
+        }
+        received += size;
+        if (size > 0 && reader.takeWriterWakeup()) {
+            toWriter.ring();
+        }
+        // A lost wakeup hangs here
+        if (size == 0 && reader.waitForData()) {
+            toReader.wait();
+        }
+    }
+    producer.join();
+    check(intact, "streamed bytes arrive in order");
+    check(reader.available() == 0, "stream leaves the ring empty");
+}
+
+}
+
+int main() {
+    testEmptyAndFull();
+    testWraparound();
+    testWakeupHandshake();
+    testStream();
+    std::printf("shared_ring: all checks passed\n");
+    return 0;
+}
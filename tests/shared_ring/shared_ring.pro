@@ -0,0 +1,16 @@
+# Unit test of SharedRing, plain C++ without Qt.
+# Exits with a non-zero status on the first failed check, see main.cpp.
+
+CONFIG += c++17 console thread
+CONFIG -= app_bundle qt
+
+TARGET = shared_ring_test
+
+INCLUDEPATH += ../../character_client
+
+SOURCES += \
+    main.cpp \
+    ../../character_client/shared_ring.cpp
+
+HEADERS += \
+    ../../character_client/shared_ring.h
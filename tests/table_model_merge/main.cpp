@@ -0,0 +1,175 @@
+/**
+ * \file main.cpp
+ * \brief Unit test of the roster merge in CharacterTableModel
+ *
+ * \details Refreshes a model holding an old roster with a new one fed in
+ * chunks, as MainWindow does while a stream arrives. A complete refresh
+ * has to leave the rows of the new roster in server order, each id once
+ * even where the roster repeats it: within one run of new rows, after a
+ * merged row and across chunks. The id to row index has to agree with
+ * the rows after every chunk.
+ *
+ * Needs only QtCore, no event loop is run.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "character_table_model.h"
+
+namespace {
+
+void check(bool condition, const char* what) {
+    if (!condition) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        std::exit(1);
+    }
+}
+
+CharacterData makeCharacter(int32_t id, uint8_t age = 30) {
+    CharacterData character;
+    character.id = id;
+    character.age = age;
+    character.name = "Name" + std::to_string(id);
+    character.surname = "Surname";
+    character.bio = "Bio";
+    return character;
+}
+
+std::vector<CharacterData> makeRoster(const std::vector<int32_t>& ids) {
+    std::vector<CharacterData> roster;
+    for (int32_t id : ids) {
+        roster.push_back(makeCharacter(id));
+    }
+    return roster;
+}
+
+std::vector<int32_t> rowIds(const CharacterTableModel& model) {
+    std::vector<int32_t> ids;
+    for (int row = 0; row < model.rowCount(); ++row) {
+        ids.push_back(model.idAt(row));
+    }
+    return ids;
+}
+
+// Every row is found under its id, and no id holds two rows
+void checkIndex(const CharacterTableModel& model, const char* what) {
+    std::unordered_set<int32_t> seen;
+    for (int row = 0; row < model.rowCount(); ++row) {
+        const int32_t id = model.idAt(row);
+        check(seen.insert(id).second, what);
+        check(model.rowForId(id) == row, what);
+    }
+}
+
+// First occurrences in roster order, what a complete refresh leaves
+std::vector<int32_t> firstOccurrences(const std::vector<int32_t>& ids) {
+    std::unordered_set<int32_t> seen;
+    std::vector<int32_t> unique;
+    for (int32_t id : ids) {
+        if (seen.insert(id).second) {
+            unique.push_back(id);
+        }
+    }
+    return unique;
+}
+
+// Merges the roster in chunks of the given sizes, the last one takes the rest
+void refresh(CharacterTableModel& model, const std::vector<int32_t>& ids,
+             const std::vector<size_t>& chunks, const char* what) {
+    const std::vector<CharacterData> roster = makeRoster(ids);
+    model.beginRefresh();
+    size_t next = 0;
+    for (size_t i = 0; next < roster.size(); ++i) {
+        const size_t size = (i < chunks.size()) ? chunks[i] : roster.size() - next;
+        const auto from = roster.begin() + static_cast<std::ptrdiff_t>(next);
+        model.mergeCharacters(std::vector<CharacterData>(from, from + static_cast<std::ptrdiff_t>(size)));
+        next += size;
+        checkIndex(model, what);
+    }
+    model.endRefresh(true);
+    checkIndex(model, what);
+    check(rowIds(model) == firstOccurrences(ids), what);
+}
+
+void testRepeatWithinRun() {
+    CharacterTableModel model;
+    model.setCharacters(makeRoster({1, 2}));
+    // 5 comes back before the run of new rows holding it is inserted
+    refresh(model, {1, 5, 6, 5, 2}, {}, "id repeated within a run of new rows");
+
+    model.setCharacters(makeRoster({1, 2}));
+    refresh(model, {7, 7, 7, 1, 8, 9, 8, 9, 2}, {}, "ids repeated back to back");
+}
+
+void testRepeatOfMergedRow() {
+    CharacterTableModel model;
+    model.setCharacters(makeRoster({1, 2, 3}));
+    refresh(model, {1, 5, 1, 6, 2, 3}, {}, "merged id repeated before a new row");
+    refresh(model, {1, 2, 2, 3, 3}, {}, "merged ids repeated back to back");
+}
+
+void testRepeatAcrossChunks() {
+    CharacterTableModel model;
+    model.setCharacters(makeRoster({1, 2}));
+    refresh(model, {1, 5, 5, 6, 2, 6}, {2, 2}, "id repeated in the next chunk");
+    refresh(model, {4, 4}, {1}, "new id repeated in the next chunk");
+}
+
+void testSkippedRows() {
+    CharacterTableModel model;
+    model.setCharacters(makeRoster({1, 2, 3, 4, 5}));
+    refresh(model, {2, 9, 4}, {1}, "rows the roster skipped are removed");
+
+    // Incomplete, rows not reached yet are kept behind the merged ones
+    model.beginRefresh();
+    model.mergeCharacters(makeRoster({9, 9, 7}));
+    checkIndex(model, "partial refresh");
+    model.endRefresh(false);
+    checkIndex(model, "failed refresh");
+    check(rowIds(model) == std::vector<int32_t>({9, 7, 4}), "failed refresh keeps the rest");
+}
+
+void testRandomRosters() {
+    std::mt19937 random(7);
+    for (int round = 0; round < 2000; ++round) {
+        // Few distinct ids, so repeats land everywhere
+        std::vector<int32_t> old;
+        for (size_t i = random() % 12; i > 0; --i) {
+            old.push_back(static_cast<int32_t>(random() % 16));
+        }
+        CharacterTableModel model;
+        model.setCharacters(makeRoster(firstOccurrences(old)));
+        checkIndex(model, "random old roster");
+
+        std::vector<int32_t> ids;
+        for (size_t i = random() % 24; i > 0; --i) {
+            ids.push_back(static_cast<int32_t>(random() % 16));
+        }
+        std::vector<size_t> chunks;
+        for (size_t left = ids.size(); left > 0;) {
+            const size_t size = std::min<size_t>(left, 1 + random() % 5);
+            chunks.push_back(size);
+            left -= size;
+        }
+        refresh(model, ids, chunks, "random refresh");
+    }
+}
+
+}
+
+int main() {
+    testRepeatWithinRun();
+    testRepeatOfMergedRow();
+    testRepeatAcrossChunks();
+    testSkippedRows();
+    testRandomRosters();
+    std::printf("table_model_merge: all checks passed\n");
+    return 0;
+}
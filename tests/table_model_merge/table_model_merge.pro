@@ -0,0 +1,21 @@
+# Unit test of the roster merge in CharacterTableModel.
+# Exits with a non-zero status on the first failed check, see main.cpp.
+
+QT       += core
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = table_model_merge_test
+
+INCLUDEPATH += ../../character_client
+
+SOURCES += \
+    main.cpp \
+    ../../character_client/character_table_model.cpp \
+    ../../character_client/protocol.cpp
+
+HEADERS += \
+    ../../character_client/character_table_model.h \
+    ../../character_client/protocol.h